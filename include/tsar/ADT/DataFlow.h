@@ -34,6 +34,8 @@
 //  * RegionDFTraits - It must be specialized to determine data-flow framework
 //                     for a hierarchy of regions.
 //  * solveDataFlow...() - It should be used to solve data-flow problem.
+//  * DataFlowStatistics - It can be used to collect statistics of convergence
+//                         of data-flow solvers.
 //  * SmallDFNode - It can be inherited to represent nodes of a data-flow graph.
 //
 //===----------------------------------------------------------------------===//
@@ -41,12 +43,17 @@
 #ifndef TSAR_DATA_FLOW_H
 #define TSAR_DATA_FLOW_H
 
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/GraphTraits.h>
 #include <llvm/ADT/iterator_range.h>
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/Support/ThreadPool.h>
 #include <algorithm>
+#include <future>
 #include <iterator>
+#include <mutex>
 #include <type_traits>
 #include <vector>
 #include <bcl/utility.h>
@@ -87,6 +94,16 @@ namespace tsar {
 /// - static meetOperator(const ValueType &, ValueType &, DFFwk &, GraphType &) -
 ///     Evaluates a meet operator, the result is stored in the second
 ///     parameter.
+/// - static DataFlowStatistics *getStatistics(DFFwk &) (optional) -
+///     Returns a collector of statistics or nullptr if statistics should not
+///     be collected.
+/// - static std::size_t size(const ValueType &) (optional) -
+///     Returns cardinality of a data-flow value, it is used to collect
+///     statistics only.
+/// - static bool isWorklistForced(DFFwk &) (optional) -
+///     Returns true if problems for acyclic graphs in a hierarchy of regions
+///     should be also solved with the use of a worklist. This is useful to
+///     check that different solvers produce the same results.
 /// - static bool transferFunction(ValueType, NodeRef, DFFwk &, GraphType &)
 ///     Evaluates a transfer function for the specified node. This returns
 ///     true if produced data-flow value differs from the data-flow value
@@ -120,6 +137,148 @@ template <class GraphType> struct Backward {
   inline Backward(const GraphType &G) : Graph(G) {}
 };
 
+/// \brief Statistics of convergence of data-flow solvers.
+///
+/// Each call of a solver for a data-flow graph (for example, for a region in
+/// a hierarchy of regions) is accounted separately. It is safe to collect
+/// statistics for sibling regions which are solved concurrently.
+/// To collect statistics DataFlowTraits::getStatistics() should be specified.
+class DataFlowStatistics : private bcl::Uncopyable {
+public:
+  /// Statistics of a data-flow problem for a single data-flow graph.
+  struct RegionStatistics {
+    /// Number of nodes in a data-flow graph.
+    std::size_t Nodes = 0;
+    /// Number of sweeps over nodes of a data-flow graph.
+    std::size_t Iterations = 0;
+    /// Number of evaluations of transfer functions.
+    std::size_t TransferCalls = 0;
+    /// Number of evaluations of transfer functions which change values.
+    std::size_t ChangedNodes = 0;
+    /// Maximum cardinality of a computed data-flow value.
+    std::size_t MaxSetSize = 0;
+  };
+
+  /// Accounts statistics for a data-flow graph.
+  void add(const RegionStatistics &S) {
+    std::lock_guard<std::mutex> Lock(mMutex);
+    ++mRegions;
+    mNodes += S.Nodes;
+    mIterations += S.Iterations;
+    mMaxIterations = std::max(mMaxIterations, S.Iterations);
+    mTransferCalls += S.TransferCalls;
+    mChangedNodes += S.ChangedNodes;
+    mMaxSetSize = std::max(mMaxSetSize, S.MaxSetSize);
+  }
+
+  /// Returns number of solved data-flow graphs.
+  std::size_t getNumRegions() const noexcept { return mRegions; }
+
+  /// Returns total number of nodes in solved data-flow graphs.
+  std::size_t getNumNodes() const noexcept { return mNodes; }
+
+  /// Returns total number of sweeps over nodes of data-flow graphs.
+  std::size_t getIterations() const noexcept { return mIterations; }
+
+  /// Returns maximum number of sweeps over nodes of a data-flow graph.
+  std::size_t getMaxIterations() const noexcept { return mMaxIterations; }
+
+  /// Returns number of evaluations of transfer functions.
+  std::size_t getTransferCalls() const noexcept { return mTransferCalls; }
+
+  /// Returns number of evaluations of transfer functions which change values.
+  std::size_t getChangedNodes() const noexcept { return mChangedNodes; }
+
+  /// Returns maximum cardinality of a computed data-flow value.
+  std::size_t getMaxSetSize() const noexcept { return mMaxSetSize; }
+
+  /// Applies a specified function to each counter.
+  ///
+  /// The function should have the following signature:
+  /// `void(llvm::StringRef Name, std::size_t Value)`.
+  template<class FuncT> void for_each_counter(FuncT &&Func) const {
+    Func("df-regions", mRegions);
+    Func("df-graph-nodes", mNodes);
+    Func("df-iterations", mIterations);
+    Func("df-max-iterations", mMaxIterations);
+    Func("df-transfers", mTransferCalls);
+    Func("df-changed-nodes", mChangedNodes);
+    Func("df-max-set-size", mMaxSetSize);
+  }
+
+private:
+  std::mutex mMutex;
+  std::size_t mRegions = 0;
+  std::size_t mNodes = 0;
+  std::size_t mIterations = 0;
+  std::size_t mMaxIterations = 0;
+  std::size_t mTransferCalls = 0;
+  std::size_t mChangedNodes = 0;
+  std::size_t mMaxSetSize = 0;
+};
+
+namespace detail {
+template<class DFT, class DFFwk>
+auto getStatistics(DFFwk DFF, int) -> decltype(DFT::getStatistics(DFF)) {
+  return DFT::getStatistics(DFF);
+}
+
+template<class DFT, class DFFwk>
+DataFlowStatistics * getStatistics(DFFwk, long) { return nullptr; }
+
+template<class DFT, class DFFwk>
+auto isWorklistForced(DFFwk DFF, int) -> decltype(DFT::isWorklistForced(DFF)) {
+  return DFT::isWorklistForced(DFF);
+}
+
+template<class DFT, class DFFwk>
+bool isWorklistForced(DFFwk, long) { return false; }
+
+template<class DFT, class ValueType>
+auto getValueSize(const ValueType &V, int) -> decltype(DFT::size(V)) {
+  return DFT::size(V);
+}
+
+template<class DFT, class ValueType>
+std::size_t getValueSize(const ValueType &, long) { return 0; }
+
+/// Collects statistics for a single data-flow graph if it is requested by
+/// a data-flow framework.
+template<class DFFwk> class DataFlowStatisticsCollector {
+  typedef DataFlowTraits<DFFwk> DFT;
+public:
+  explicit DataFlowStatisticsCollector(DFFwk DFF) :
+    mDFF(DFF), mStats(getStatistics<DFT>(DFF, 0)) {}
+
+  /// Accounts collected statistics.
+  ~DataFlowStatisticsCollector() {
+    if (mStats)
+      mStats->add(mRegion);
+  }
+
+  void setNodes(std::size_t Nodes) noexcept { mRegion.Nodes = Nodes; }
+
+  void startIteration() noexcept { ++mRegion.Iterations; }
+
+  /// Accounts evaluation of a transfer function for a specified node.
+  template<class NodeRef> void transfer(NodeRef N, bool IsChanged) {
+    if (!mStats)
+      return;
+    ++mRegion.TransferCalls;
+    if (IsChanged)
+      ++mRegion.ChangedNodes;
+    mRegion.MaxSetSize = std::max(mRegion.MaxSetSize,
+      static_cast<std::size_t>(
+        getValueSize<DFT>(DFT::getValue(N, mDFF), 0)));
+  }
+
+private:
+  DFFwk mDFF;
+  DataFlowStatistics *mStats;
+  DataFlowStatistics::RegionStatistics mRegion;
+};
+}
+
 /// \brief Iteratively solves data-flow problem.
 ///
 /// This computes IN and OUT for each node in the specified data-flow graph
@@ -144,16 +303,20 @@ template<class DFFwk> void solveDataFlowIteratively(DFFwk DFF,
   typedef llvm::GraphTraits<GraphType> GT;
   typedef typename GT::nodes_iterator nodes_iterator;
   typedef typename GT::ChildIteratorType ChildIteratorType;
+  detail::DataFlowStatisticsCollector<DFFwk> Stats(DFF);
+  std::size_t NumNodes = 1;
   for (nodes_iterator I = GT::nodes_begin(DFG), E = GT::nodes_end(DFG);
-       I != E; ++I) {
+       I != E; ++I, ++NumNodes) {
     DFT::initialize(*I, DFF, DFG);
     DFT::setValue(DFT::topElement(DFF, DFG), *I, DFF);
   }
+  Stats.setNodes(NumNodes);
   DFT::initialize(GT::getEntryNode(DFG), DFF, DFG);
   DFT::setValue(DFT::boundaryCondition(DFF, DFG), GT::getEntryNode(DFG), DFF);
   bool isChanged = true;
   do {
     isChanged = false;
+    Stats.startIteration();
     for (nodes_iterator I = GT::nodes_begin(DFG), E = GT::nodes_end(DFG);
          I != E; ++I) {
       assert((*I == GT::getEntryNode(DFG) ||
@@ -164,12 +327,107 @@ template<class DFFwk> void solveDataFlowIteratively(DFFwk DFF,
            CI != CE; ++CI) {
         DFT::meetOperator(DFT::getValue(*CI, DFF), Value, DFF, DFG);
       }
-      isChanged =
-        DFT::transferFunction(std::move(Value), *I, DFF, DFG) || isChanged;
+      bool IsNodeChanged =
+        DFT::transferFunction(std::move(Value), *I, DFF, DFG);
+      Stats.transfer(*I, IsNodeChanged);
+      isChanged |= IsNodeChanged;
     }
   } while (isChanged);
 }
 
+/// \brief Solves data-flow problem with the use of a worklist.
+///
+/// Unlike solveDataFlowIteratively() this does not evaluate each node on each
+/// iteration. A node is evaluated again only if a data-flow value of some of
+/// nodes which it depends on has been changed. Nodes from the worklist are
+/// evaluated in reverse post-order of a data-flow graph (in a direction
+/// of data-flow), so values are propagated along forward edges during a single
+/// sweep and back edges lead to additional sweeps over changed parts of
+/// the graph only.
+///
+/// The last computed value for each node can be obtained by calling
+/// the DataFlowTraits::getValue() function.
+/// The type of computed value (IN or OUT) depends on a data-flow direction
+/// (see DataFlowTratis). In case of a forward direction it is OUT,
+/// otherwise IN.
+/// \param [in, out] DFF Data-flow framework, it can not be null.
+/// \param [in, out] DFG Data-flow graph specified in the data-flow framework.
+/// Subgraph of this graph also can be used.
+/// \attention The DataFlowTraits class should be specialized by DFFwk.
+/// Note that DFFwk is generally a pointer type.
+/// The GraphTraits class should be specialized by
+/// DataFlowTraits<DFFwk>::GraphType and by llvm::Inverse of this type.
+/// \pre The graph must not contain unreachable nodes.
+template<class DFFwk> void solveDataFlowWorklist(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG) {
+  typedef DataFlowTraits<DFFwk> DFT;
+  typedef typename DFT::ValueType ValueType;
+  typedef typename DFT::GraphType GraphType;
+  typedef llvm::GraphTraits<GraphType> GT;
+  typedef llvm::GraphTraits<llvm::Inverse<GraphType>> InvGT;
+  typedef typename GT::nodes_iterator nodes_iterator;
+  typedef typename GT::ChildIteratorType ChildIteratorType;
+  typedef typename InvGT::ChildIteratorType InvChildIteratorType;
+  typedef typename GT::NodeRef NodeRef;
+  typedef llvm::po_iterator<
+    GraphType, llvm::SmallPtrSet<NodeRef, 8>, false, InvGT> po_iterator;
+  std::vector<NodeRef> RPOT;
+  std::copy(po_iterator::begin(DFG), po_iterator::end(DFG),
+            std::back_inserter(RPOT));
+  std::reverse(RPOT.begin(), RPOT.end());
+  assert(!RPOT.empty() && RPOT.front() == GT::getEntryNode(DFG) &&
+    "The first node in the topological order differs from the entry node in the data-flow framework!");
+  llvm::DenseMap<NodeRef, unsigned> Order;
+  Order.reserve(RPOT.size());
+  for (unsigned Idx = 0, IdxE = RPOT.size(); Idx < IdxE; ++Idx)
+    Order.try_emplace(RPOT[Idx], Idx);
+  // Initialize the same nodes as solveDataFlowIteratively() does. Nodes which
+  // have not been visited during the traversal (this is possible for
+  // a backward problem if some nodes do not reach an exit) are evaluated
+  // after all other nodes.
+  for (nodes_iterator I = GT::nodes_begin(DFG), E = GT::nodes_end(DFG);
+       I != E; ++I) {
+    assert((*I == GT::getEntryNode(DFG) ||
+      GT::child_begin(*I) != GT::child_end(*I)) &&
+      "Data-flow graph must not contain unreachable nodes!");
+    DFT::initialize(*I, DFF, DFG);
+    DFT::setValue(DFT::topElement(DFF, DFG), *I, DFF);
+    if (Order.try_emplace(*I, RPOT.size()).second)
+      RPOT.push_back(*I);
+  }
+  DFT::initialize(GT::getEntryNode(DFG), DFF, DFG);
+  DFT::setValue(DFT::boundaryCondition(DFF, DFG), GT::getEntryNode(DFG), DFF);
+  // Each node except the entry node should be evaluated at least once.
+  llvm::BitVector Worklist(RPOT.size(), true);
+  Worklist.reset(0);
+  detail::DataFlowStatisticsCollector<DFFwk> Stats(DFF);
+  Stats.setNodes(RPOT.size());
+  // Nodes which follow the current node in RPO are evaluated during
+  // the current sweep, other nodes are evaluated during the next sweep.
+  while (Worklist.any()) {
+    Stats.startIteration();
+    for (int Idx = Worklist.find_first(); Idx >= 0;
+         Idx = Worklist.find_next(Idx)) {
+      Worklist.reset(Idx);
+      NodeRef N = RPOT[Idx];
+      ValueType Value(DFT::topElement(DFF, DFG));
+      for (ChildIteratorType CI = GT::child_begin(N), CE = GT::child_end(N);
+           CI != CE; ++CI)
+        DFT::meetOperator(DFT::getValue(*CI, DFF), Value, DFF, DFG);
+      bool IsChanged = DFT::transferFunction(std::move(Value), N, DFF, DFG);
+      Stats.transfer(N, IsChanged);
+      if (!IsChanged)
+        continue;
+      for (InvChildIteratorType CI = InvGT::child_begin(N),
+           CE = InvGT::child_end(N); CI != CE; ++CI) {
+        auto OrderItr = Order.find(*CI);
+        if (OrderItr != Order.end() && OrderItr->second != 0)
+          Worklist.set(OrderItr->second);
+      }
+    }
+  }
+}
+
 /// \brief Solves data-flow problem in topological order during one iteration.
 ///
 /// This computes IN and OUT for each node in the specified data-flow graph
@@ -224,13 +482,17 @@ template<class DFFwk> void solveDataFlowTopologicaly(DFFwk DFF,
   }
   DFT::initialize(GT::getEntryNode(DFG), DFF, DFG);
   DFT::setValue(DFT::boundaryCondition(DFF, DFG), GT::getEntryNode(DFG), DFF);
+  detail::DataFlowStatisticsCollector<DFFwk> Stats(DFF);
+  Stats.setNodes(RPOT.size());
+  Stats.startIteration();
   for (I = RPOT.rbegin(), ++I; I != E; ++I) {
     ValueType Value(DFT::topElement(DFF, DFG));
     for (ChildIteratorType CI = GT::child_begin(*I), CE = GT::child_end(*I);
          CI != CE; ++CI) {
       DFT::meetOperator(DFT::getValue(*CI, DFF), Value, DFF, DFG);
     }
-    DFT::transferFunction(std::move(Value), *I, DFF, DFG);
+    bool IsChanged = DFT::transferFunction(std::move(Value), *I, DFF, DFG);
+    Stats.transfer(*I, IsChanged);
   }
 }
 
@@ -252,6 +514,11 @@ template<class DFFwk> void solveDataFlowTopologicaly(DFFwk DFF,
 ///   static region_iterator region_begin(GraphType &G),
 ///   static region_iterator region_end (GraphType &G) -
 ///     Allow iteration over all internal regions in the specified region.
+/// - static constexpr bool IsThreadSafe (optional) -
+///     If it is true, data-flow problems for sibling regions can be solved
+///     concurrently. So, all functions from DataFlowTraits and RegionDFTraits
+///     may be called concurrently for nodes of different sibling regions.
+///     Collapse of a region must depend on the nodes of this region only.
 /// \note It may be convenient to inherit DataFlowTraits to specialize this
 /// class.
 /// \note Whether regions at different levels of hierarchy have the same type
@@ -268,6 +535,63 @@ template<class DFFwk > struct RegionDFTraits {
   typedef typename DFFwk::UnknownFrameworkError GraphType;
 };
 
+namespace detail {
+template<class... Ts> struct MakeVoid { typedef void type; };
+
+/// Evaluates to true if RegionDFTraits specialization RT declares that
+/// its data-flow framework is thread-safe.
+template<class RT, class = void>
+struct IsThreadSafeRegionDF : std::false_type {};
+
+template<class RT>
+struct IsThreadSafeRegionDF<RT,
+    typename MakeVoid<decltype(RT::IsThreadSafe)>::type> :
+  std::integral_constant<bool, RT::IsThreadSafe> {};
+
+/// Solves data-flow problem for a single graph in a hierarchy of regions.
+///
+/// If it is possible the problem is solved in topological order in a single
+/// pass, otherwise (or if it is forced by the data-flow framework) with
+/// the use of a worklist.
+template<class DFFwk> void solveRegionGraph(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG) {
+  if (!isWorklistForced<DataFlowTraits<DFFwk>>(DFF, 0) && isDAG(DFG))
+    solveDataFlowTopologicaly(DFF, DFG);
+  else
+    solveDataFlowWorklist(DFF, DFG);
+}
+
+/// Solves data-flow problem for the specified hierarchy of regions
+/// (see solveDataFlowUpward()) but does not collapse the specified graph.
+template<class DFFwk> void solveRegionUpward(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG);
+
+/// Solves data-flow problem for the specified hierarchy of regions
+/// (see solveDataFlowDownward()) but does not collapse the specified graph.
+template<class DFFwk> void solveRegionDownward(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG);
+
+/// Solves data-flow problems for all internal regions of the specified graph
+/// concurrently and then collapses them in order of region iterators.
+template<class DFFwk, class SolverT> void solveSubregionsConcurrently(
+    DFFwk DFF, typename DataFlowTraits<DFFwk>::GraphType DFG,
+    llvm::ThreadPool &Pool, SolverT Solver) {
+  typedef RegionDFTraits<DFFwk> RT;
+  typedef typename RT::region_iterator region_iterator;
+  std::vector<std::shared_future<void>> Tasks;
+  for (region_iterator I = RT::region_begin(DFG), E = RT::region_end(DFG);
+       I != E; ++I)
+    Tasks.push_back(Pool.async([DFF, I, Solver]() { Solver(DFF, *I); }));
+  // Note, that ThreadPool::wait() is not used because the pool may be shared
+  // with other tasks.
+  for (auto &T : Tasks)
+    T.wait();
+  for (region_iterator I = RT::region_begin(DFG), E = RT::region_end(DFG);
+       I != E; ++I)
+    RT::collapse(DFF, *I);
+}
+}
+
 /// \brief Solves data-flow problem for the specified hierarchy of regions.
 ///
 /// The data-flow problems solves upward from innermost regions to the region
@@ -278,7 +602,8 @@ template<class DFFwk > struct RegionDFTraits {
 /// one node which is associated with the whole specified graph. When traversing
 /// from the specified graph to innermost graphs, regions will be consistently
 /// expanded to a data-flow graph. If it is possible the problem will be solved
-/// in topological order in a single pass, otherwise iteratively.
+/// in topological order in a single pass, otherwise with the use of
+/// a worklist (see solveDataFlowWorklist()).
 /// \param [in, out] DFF Data-flow framework, it can not be null.
 /// \param [in, out] DFG Data-flow graph specified in the data-flow framework.
 /// Subgraph of this graph also can be used.
@@ -290,16 +615,36 @@ template<class DFFwk > struct RegionDFTraits {
 /// \pre The graph must not contain unreachable nodes.
 template<class DFFwk> void solveDataFlowUpward(DFFwk DFF,
     typename DataFlowTraits<DFFwk>::GraphType DFG) {
+  detail::solveRegionUpward(DFF, DFG);
+  RegionDFTraits<DFFwk>::collapse(DFF, DFG);
+}
+
+/// \brief Solves data-flow problem for the specified hierarchy of regions,
+/// internal regions of the specified graph are solved concurrently.
+///
+/// This is similar to solveDataFlowUpward(DFF, DFG), however data-flow
+/// problems for internal regions of the specified graph are solved
+/// on a specified thread pool. Each of these regions (including its internal
+/// regions) is solved in a single thread. When all of them have been solved,
+/// they are collapsed in order of region iterators, so results do not depend
+/// on the order of execution of tasks.
+///
+/// If RegionDFTraits<DFFwk> does not declare the framework as thread-safe
+/// (see IsThreadSafe), the problem is solved sequentially.
+template<class DFFwk> void solveDataFlowUpward(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG, llvm::ThreadPool &Pool) {
   typedef RegionDFTraits<DFFwk> RT;
-  typedef typename RT::region_iterator region_iterator;
+  if (!detail::IsThreadSafeRegionDF<RT>::value ||
+      std::distance(RT::region_begin(DFG), RT::region_end(DFG)) < 2) {
+    solveDataFlowUpward(DFF, DFG);
+    return;
+  }
   RT::expand(DFF, DFG);
-  for (region_iterator I = RT::region_begin(DFG), E = RT::region_end(DFG);
-       I != E; ++I)
-    solveDataFlowUpward(DFF, *I);
-  if (isDAG(DFG))
-    solveDataFlowTopologicaly(DFF, DFG);
-  else
-    solveDataFlowIteratively(DFF, DFG);
+  detail::solveSubregionsConcurrently(DFF, DFG, Pool,
+    [](DFFwk DFF, typename DataFlowTraits<DFFwk>::GraphType G) {
+      detail::solveRegionUpward(DFF, G);
+    });
+  detail::solveRegionGraph(DFF, DFG);
   RT::collapse(DFF, DFG);
 }
 
@@ -315,7 +660,8 @@ template<class DFFwk> void solveDataFlowUpward(DFFwk DFF,
 /// a one node in a data-flow graph associated with this region.
 /// The specified graph will be also collapsed
 /// If it is possible the problem will be solved in topological order
-/// in a single pass, otherwise iteratively.
+/// in a single pass, otherwise with the use of a worklist
+/// (see solveDataFlowWorklist()).
 /// \param [in, out] DFF Data-flow framework, it can not be null.
 /// \param [in, out] DFG Data-flow graph specified in the data-flow framework.
 /// Subgraph of this graph also can be used.
@@ -327,17 +673,56 @@ template<class DFFwk> void solveDataFlowUpward(DFFwk DFF,
 /// \pre The graph must not contain unreachable nodes.
 template<class DFFwk> void solveDataFlowDownward(DFFwk DFF,
   typename DataFlowTraits<DFFwk>::GraphType DFG) {
+  detail::solveRegionDownward(DFF, DFG);
+  RegionDFTraits<DFFwk>::collapse(DFF, DFG);
+}
+
+/// \brief Solves data-flow problem for the specified hierarchy of regions,
+/// internal regions of the specified graph are solved concurrently.
+///
+/// This is similar to solveDataFlowDownward(DFF, DFG), however when
+/// the data-flow problem for the specified graph has been solved, problems for
+/// its internal regions are solved on a specified thread pool (see
+/// solveDataFlowUpward(DFF, DFG, Pool) for details).
+template<class DFFwk> void solveDataFlowDownward(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG, llvm::ThreadPool &Pool) {
+  typedef RegionDFTraits<DFFwk> RT;
+  if (!detail::IsThreadSafeRegionDF<RT>::value ||
+      std::distance(RT::region_begin(DFG), RT::region_end(DFG)) < 2) {
+    solveDataFlowDownward(DFF, DFG);
+    return;
+  }
+  RT::expand(DFF, DFG);
+  detail::solveRegionGraph(DFF, DFG);
+  detail::solveSubregionsConcurrently(DFF, DFG, Pool,
+    [](DFFwk DFF, typename DataFlowTraits<DFFwk>::GraphType G) {
+      detail::solveRegionDownward(DFF, G);
+    });
+  RT::collapse(DFF, DFG);
+}
+
+namespace detail {
+template<class DFFwk> void solveRegionUpward(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG) {
   typedef RegionDFTraits<DFFwk> RT;
   typedef typename RT::region_iterator region_iterator;
   RT::expand(DFF, DFG);
-  if (isDAG(DFG))
-    solveDataFlowTopologicaly(DFF, DFG);
-  else
-    solveDataFlowIteratively(DFF, DFG);
+  for (region_iterator I = RT::region_begin(DFG), E = RT::region_end(DFG);
+       I != E; ++I)
+    solveDataFlowUpward(DFF, *I);
+  solveRegionGraph(DFF, DFG);
+}
+
+template<class DFFwk> void solveRegionDownward(DFFwk DFF,
+    typename DataFlowTraits<DFFwk>::GraphType DFG) {
+  typedef RegionDFTraits<DFFwk> RT;
+  typedef typename RT::region_iterator region_iterator;
+  RT::expand(DFF, DFG);
+  solveRegionGraph(DFF, DFG);
   for (region_iterator I = RT::region_begin(DFG), E = RT::region_end(DFG);
        I != E; ++I)
     solveDataFlowDownward(DFF, *I);
-  RT::collapse(DFF, DFG);
+}
 }
 
 namespace detail{
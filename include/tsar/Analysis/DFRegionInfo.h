@@ -34,15 +34,23 @@
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/Analysis/LoopInfo.h>
 #include <llvm/Pass.h>
+#include <llvm/Support/Allocator.h>
 
 namespace tsar {
 /// \brief Builds hierarchy of regions for the specified region level.
 ///
 /// To obtain the whole constructed hierarchy it is necessary to use
 /// DFRegionInfoPass.
+///
+/// All nodes in the hierarchy are allocated in an arena which is owned by
+/// this object. So, allocation of a node is cheap and memory for the whole
+/// hierarchy is freed at once.
 class DFRegionInfo : private bcl::Uncopyable {
   typedef llvm::DenseMap<const llvm::BasicBlock *, tsar::DFNode *> BBToNodeMap;
 public:
+  /// Destroys the whole hierarchy of regions.
+  ~DFRegionInfo() { releaseMemory(); }
+
   /// Returns outermost region in the hierarchy.
   tsar::DFNode * getTopLevelRegion() const noexcept { return mTopLevelRegion; }
 
@@ -55,14 +63,11 @@ public:
   /// Returns the smallest region that surrounds a specified loop.
   tsar::DFNode * getRegionFor(llvm::Loop *L) const;
 
-  /// Releases memory.
-  void releaseMemory() {
-    if (mTopLevelRegion) {
-      delete mTopLevelRegion;
-      mTopLevelRegion = nullptr;
-    }
-    mBBToNode.clear();
-  }
+  /// \brief Releases memory.
+  ///
+  /// Destructors of all nodes are called and the arena is reset. The first
+  /// slab of the arena is kept to be reused for the next hierarchy.
+  void releaseMemory();
 
   /// \brief Treats all loops in a function as regions and build the region
   /// hierarchy.
@@ -94,8 +99,15 @@ private:
   template<class LoopReptn>
   void buildLoopRegion(LoopReptn L, tsar::DFRegion *R);
 
+  /// Allocates a new node in the arena.
+  template<class NodeT, class... ArgT> NodeT * createNode(ArgT &&... Args) {
+    return new (mAllocator.Allocate<NodeT>())
+      NodeT(std::forward<ArgT>(Args)...);
+  }
+
   tsar::DFNode *mTopLevelRegion = nullptr;
   BBToNodeMap mBBToNode;
+  llvm::BumpPtrAllocator mAllocator;
 };
 }
 
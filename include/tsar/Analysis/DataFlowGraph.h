@@ -221,14 +221,6 @@ public:
       N->getKind() <= LAST_KIND_REGION;
   }
 
-  /// \brief Deletes all nodes in the region.
-  ///
-  /// A memory which was allocated for the nodes is freed.
-  ~DFRegion() {
-    for (DFNode *N : mNodes)
-      delete N;
-  }
-
   /// Get the number of nodes in this region.
   size_t getNumNodes() const { return mNodes.size(); }
 
@@ -294,8 +286,10 @@ public:
 
   /// \brief Inserts a new node at the end of the list of nodes.
   ///
-  /// \attention The inserted node falls under the control of the region and
-  /// will be destroyed at the same time when the region will be destroyed.
+  /// \attention The region does not own the inserted node. All nodes in
+  /// a hierarchy are owned by an object which builds this hierarchy
+  /// (for example, tsar::DFRegionInfo), so they must not be destroyed before
+  /// the region.
   /// \pre
   /// - A new node can not take a null value.
   /// - The node should be differ from other nodes of the graph.
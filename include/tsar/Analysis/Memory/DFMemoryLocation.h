@@ -26,10 +26,19 @@
 #ifndef TSAR_DF_LOCATION_H
 #define TSAR_DF_LOCATION_H
 
+#include "tsar/Analysis/Memory/IntervalMemorySet.h"
 #include "tsar/Analysis/Memory/MemoryLocationRange.h"
 #include "tsar/Analysis/Memory/MemorySet.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/BitVector.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/DebugInfoMetadata.h>
+#include <iterator>
+#include <vector>
 
 namespace llvm {
 class DominatorTree;
@@ -37,11 +46,230 @@ class raw_ostream;
 }
 
 namespace tsar {
+class LocationDFNumbering;
+
+namespace detail {
+/// \brief Representation of locations in a data-flow value.
+///
+/// This representation is shared between equal data-flow values and it is
+/// copied before modification (copy-on-write). Uniqued representations are
+/// registered in a numbering of locations, so equal uniqued values refer to
+/// the same representation.
+class LocationDFStorage {
+public:
+  /// Set of locations which are not numbered.
+  using LocationSet = IntervalMemorySet<MemoryLocationRange>;
+
+  /// Returns true if two bit vectors contain the same bits. Vectors may have
+  /// different sizes.
+  static bool equalBits(const llvm::BitVector &LHS,
+                        const llvm::BitVector &RHS) {
+    if (LHS.size() == RHS.size())
+      return LHS == RHS;
+    auto &Short = LHS.size() < RHS.size() ? LHS : RHS;
+    auto &Long = LHS.size() < RHS.size() ? RHS : LHS;
+    if (Long.find_first_in(Short.size(), Long.size()) != -1)
+      return false;
+    llvm::BitVector Tmp(Short);
+    Tmp.resize(Long.size());
+    return Tmp == Long;
+  }
+
+  LocationDFStorage() = default;
+
+  /// Creates a copy of a specified representation which is not uniqued.
+  LocationDFStorage(const LocationDFStorage &From) :
+    Dense(From.Dense), Locations(From.Locations), Epoch(From.Epoch) {}
+
+  LocationDFStorage & operator=(const LocationDFStorage &) = delete;
+
+  void Retain() const { ++mRefCount; }
+  void Release() const;
+
+  /// Returns true if this representation is not shared with other values.
+  bool isUnique() const noexcept { return mRefCount == 1 && !mUniquer; }
+
+  /// Returns true if this representation is registered in a numbering.
+  bool isUniqued() const noexcept { return mUniquer; }
+
+  /// Returns a hash value for a set of locations. This value is available
+  /// for uniqued representations only.
+  unsigned getHash() const noexcept { return mHash; }
+
+  /// Returns true if two representations contain the same locations.
+  ///
+  /// Note, that locations may be represented in different ways if
+  /// one of representations has not been normalized yet.
+  bool isEqual(const LocationDFStorage &RHS) const {
+    return equalBits(Dense, RHS.Dense) && Locations == RHS.Locations;
+  }
+
+  /// Numbered locations.
+  llvm::BitVector Dense;
+
+  /// Locations which are based on sparse pointers.
+  LocationSet Locations;
+
+  /// Epoch of a numbering this representation has been normalized for.
+  unsigned Epoch = 0;
+
+private:
+  friend class tsar::LocationDFNumbering;
+
+  /// Calculates hash value which does not depend on an order of locations and
+  /// on a size of the bit vector.
+  unsigned computeHash() const {
+    auto Hash = llvm::hash_combine_range(Dense.set_bits_begin(),
+                                         Dense.set_bits_end());
+    std::size_t LocHash = 0;
+    for (auto &Loc : Locations)
+      LocHash += llvm::hash_value(Loc.Ptr);
+    return llvm::hash_combine(Hash, LocHash);
+  }
+
+  mutable unsigned mRefCount = 0;
+  unsigned mHash = 0;
+  LocationDFNumbering *mUniquer = nullptr;
+};
+
+/// Provides DenseMapInfo for representations of locations which are uniqued.
+struct LocationDFStorageInfo {
+  static inline LocationDFStorage * getEmptyKey() {
+    return llvm::DenseMapInfo<LocationDFStorage *>::getEmptyKey();
+  }
+  static inline LocationDFStorage * getTombstoneKey() {
+    return llvm::DenseMapInfo<LocationDFStorage *>::getTombstoneKey();
+  }
+  static unsigned getHashValue(const LocationDFStorage *S) {
+    return S->getHash();
+  }
+  static bool isEqual(const LocationDFStorage *LHS,
+                      const LocationDFStorage *RHS) {
+    if (LHS == RHS)
+      return true;
+    if (LHS == getEmptyKey() || LHS == getTombstoneKey() ||
+        RHS == getEmptyKey() || RHS == getTombstoneKey())
+      return false;
+    return LHS->getHash() == RHS->getHash() && LHS->isEqual(*RHS);
+  }
+};
+}
+
+/// \brief Numbering of memory locations which are accessed in a function.
+///
+/// Locations based on the same pointer obtain numbers only if they are
+/// disjoint and do not adjoin each other. So, a union and an intersection of
+/// such locations can be calculated bitwise. As soon as some location
+/// partially overlaps a location based on the same pointer, all locations
+/// based on this pointer are excluded from the numbering (the pointer becomes
+/// sparse) and data-flow values store them in a range-based set.
+///
+/// A numbering is shared between all data-flow values which are calculated
+/// for a function and it grows while the data-flow problem is solved.
+/// It also stores uniqued representations of data-flow values, so equal
+/// values share memory and can be compared by a pointer.
+class LocationDFNumbering :
+  public llvm::RefCountedBase<LocationDFNumbering> {
+public:
+  enum : unsigned { NoIndex = ~0u };
+
+  /// Returns number of a specified location or NoIndex if a location is
+  /// based on a sparse pointer.
+  ///
+  /// A new number is assigned to a location if it has not been numbered yet.
+  unsigned getOrInsert(const MemoryLocationRange &Loc);
+
+  /// Returns a location with a specified number.
+  const MemoryLocationRange & operator[](unsigned Idx) const {
+    assert(Idx < mLocations.size() && "Index is out of range!");
+    return mLocations[Idx];
+  }
+
+  /// Returns number of numbered locations.
+  unsigned size() const noexcept { return mLocations.size(); }
+
+  /// Returns true if locations based on a specified pointer are not numbered.
+  bool isSparse(const llvm::Value *Ptr) const {
+    auto I = mPointers.find(Ptr);
+    return I != mPointers.end() && I->second.IsSparse;
+  }
+
+  /// Returns numbers of locations based on a specified pointer.
+  llvm::ArrayRef<unsigned> getNumbers(const llvm::Value *Ptr) const {
+    auto I = mPointers.find(Ptr);
+    return I != mPointers.end() ? llvm::makeArrayRef(I->second.Numbers) :
+                                  llvm::ArrayRef<unsigned>();
+  }
+
+  /// Returns numbers which have been excluded from the numbering.
+  const llvm::BitVector & getSparseNumbers() const noexcept {
+    return mSparseNumbers;
+  }
+
+  /// Returns a counter which is incremented each time some pointer becomes
+  /// sparse.
+  unsigned getEpoch() const noexcept { return mEpoch; }
+
+  /// \brief Returns a uniqued representation which is equal to a specified
+  /// one.
+  ///
+  /// If there is no such representation the specified one is registered.
+  /// \pre The specified representation should be normalized and it should
+  /// not be uniqued yet.
+  detail::LocationDFStorage * getUniqued(detail::LocationDFStorage *S);
+
+  /// Removes a specified representation from a list of uniqued ones.
+  void eraseUniqued(detail::LocationDFStorage *S) {
+    assert(S->mUniquer == this && "Representation must be uniqued!");
+    mUniqued.erase(S);
+    S->mUniquer = nullptr;
+  }
+
+private:
+  struct PointerInfo {
+    llvm::SmallVector<unsigned, 2> Numbers;
+    bool IsSparse = false;
+  };
+
+  std::vector<MemoryLocationRange> mLocations;
+  llvm::DenseMap<const llvm::Value *, PointerInfo> mPointers;
+  llvm::BitVector mSparseNumbers;
+  unsigned mEpoch = 0;
+  llvm::DenseSet<detail::LocationDFStorage *,
+    detail::LocationDFStorageInfo> mUniqued;
+};
+
+inline void detail::LocationDFStorage::Release() const {
+  assert(mRefCount > 0 && "Reference count is already zero!");
+  if (--mRefCount == 0) {
+    if (mUniquer)
+      mUniquer->eraseUniqued(const_cast<LocationDFStorage *>(this));
+    delete this;
+  }
+}
+
 /// \brief Representation of a data-flow value formed by a set of locations.
 ///
 /// A data-flow value is a set of locations for which a number of operations
 /// is defined.
+///
+/// If a numbering of locations is specified, numbered locations are stored in
+/// a dense bit vector and only locations based on sparse pointers are stored
+/// in a range-based set. Values which are combined should share the same
+/// numbering to benefit from the bitwise implementation of operations.
+///
+/// Locations are stored in a representation which is shared between copies
+/// of a value and which is copied on write. Numbered values can be uniqued,
+/// so equal uniqued values share the same representation.
 class LocationDFValue {
+public:
+  /// Set of locations which are not numbered.
+  ///
+  /// Locations in this set partially overlap each other, so a set which
+  /// coalesces locations and searches them in logarithmic time is used.
+  using LocationSet = detail::LocationDFStorage::LocationSet;
+
+private:
   // There are two kind of values. The KIND_FULL kind means that the set of
   // variables is full and contains all variables used in the analyzed program.
   // The KIND_MASK kind means that the set contains variables located in the
@@ -72,6 +300,22 @@ public:
     return LocationDFValue(LocationDFValue::KIND_MASK);
   }
 
+  /// Creates a value, which contains all locations used in the analyzed
+  /// program. Locations will be numbered according to a specified numbering.
+  static LocationDFValue fullValue(LocationDFNumbering *N) {
+    LocationDFValue V(LocationDFValue::KIND_FULL);
+    V.attach(N);
+    return V;
+  }
+
+  /// Creates an empty value. Locations will be numbered according to
+  /// a specified numbering.
+  static LocationDFValue emptyValue(LocationDFNumbering *N) {
+    LocationDFValue V(LocationDFValue::KIND_MASK);
+    V.attach(N);
+    return V;
+  }
+
   /// Default constructor creates an empty value.
   LocationDFValue() : LocationDFValue(LocationDFValue::KIND_MASK) {}
 
@@ -97,29 +341,33 @@ public:
     //than Result should be empty.
     if (Value.mKind == KIND_FULL || LocBegin == LocEnd)
       return;
-    if (Value.mLocations.empty())
+    if (Value.empty()) {
       Result.insert(LocBegin, LocEnd);
+      return;
+    }
     for (location_iterator I = LocBegin; I != LocEnd; ++I)
-      if (!Value.mLocations.overlap(*I))
+      if (!Value.overlap(*I))
         Result.insert(*I);
   }
 
   /// Destructor.
   ~LocationDFValue() {
-    mLocations.clear();
+    mStorage = nullptr;
     mKind = INVALID_KIND;
   }
 
   /// Move constructor.
   LocationDFValue(LocationDFValue &&that) :
-    mKind(that.mKind), mLocations(std::move(that.mLocations)) {
+    mKind(that.mKind), mNumbering(std::move(that.mNumbering)),
+    mStorage(std::move(that.mStorage)) {
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
     assert(that.mKind != INVALID_KIND && "Collection is corrupted!");
   }
 
-  /// Copy constructor.
+  /// Copy constructor, representation of locations is shared between copies.
   LocationDFValue(const LocationDFValue &that) :
-    mKind(that.mKind), mLocations(that.mLocations) {
+    mKind(that.mKind), mNumbering(that.mNumbering),
+    mStorage(that.mStorage) {
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
     assert(that.mKind != INVALID_KIND && "Collection is corrupted!");
   }
@@ -130,7 +378,8 @@ public:
     assert(that.mKind != INVALID_KIND && "Collection is corrupted!");
     if (this != &that) {
       mKind = that.mKind;
-      mLocations = std::move(that.mLocations);
+      mStorage = std::move(that.mStorage);
+      mNumbering = std::move(that.mNumbering);
     }
     return *this;
   }
@@ -141,7 +390,8 @@ public:
     assert(that.mKind != INVALID_KIND && "Collection is corrupted!");
     if (this != &that) {
       mKind = that.mKind;
-      mLocations = that.mLocations;
+      mStorage = that.mStorage;
+      mNumbering = that.mNumbering;
     }
     return *this;
   }
@@ -150,34 +400,72 @@ public:
   /// the specified location.
   bool contain(const MemoryLocationRange &Loc) const {
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
-    return mKind == KIND_FULL || mLocations.contain(Loc);
+    if (mKind == KIND_FULL)
+      return true;
+    normalize();
+    if (!mStorage)
+      return false;
+    if (!mNumbering || mNumbering->isSparse(Loc.Ptr))
+      return mStorage->Locations.contain(Loc);
+    return getDenseLocations(Loc.Ptr).contain(Loc);
   }
 
   /// Returns true if there is a location in this value which may overlap with
   /// the specified location.
   bool overlap(const MemoryLocationRange &Loc) const {
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
-    return mKind == KIND_FULL || mLocations.overlap(Loc);
+    if (mKind == KIND_FULL)
+      return true;
+    normalize();
+    if (!mStorage)
+      return false;
+    if (!mNumbering || mNumbering->isSparse(Loc.Ptr))
+      return mStorage->Locations.overlap(Loc);
+    return getDenseLocations(Loc.Ptr).overlap(Loc);
   }
 
   /// Returns true if there is a location in this value which is contained
   /// in the specified location.
   bool cover(const MemoryLocationRange &Loc) const {
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
-    return mKind != KIND_FULL && mLocations.cover(Loc);
+    if (mKind == KIND_FULL)
+      return false;
+    normalize();
+    if (!mStorage)
+      return false;
+    if (!mNumbering || mNumbering->isSparse(Loc.Ptr))
+      return mStorage->Locations.cover(Loc);
+    return getDenseLocations(Loc.Ptr).cover(Loc);
   }
 
   /// Returns true if the value does not contain any location.
   bool empty() const {
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
-    return mKind == KIND_MASK && mLocations.empty();
+    return mKind == KIND_MASK &&
+      (!mStorage ||
+        (mStorage->Locations.empty() && mStorage->Dense.none()));
+  }
+
+  /// \brief Returns number of locations in the value.
+  ///
+  /// The full value is considered as a value which contains all numbered
+  /// locations. Locations which are not numbered are counted after
+  /// coalescing.
+  unsigned count() const {
+    assert(mKind != INVALID_KIND && "Collection is corrupted!");
+    if (mKind == KIND_FULL)
+      return mNumbering ? mNumbering->size() : 0;
+    if (!mStorage)
+      return 0;
+    return mStorage->Dense.count() +
+      std::distance(mStorage->Locations.begin(), mStorage->Locations.end());
   }
 
   /// Removes all locations from the value.
   void clear() {
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
     mKind = KIND_MASK;
-    mLocations.clear();
+    mStorage = nullptr;
   }
 
   /// \brief Inserts a new location into the value, returns false if it already
@@ -189,7 +477,16 @@ public:
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
     if (mKind == KIND_FULL)
       return true;
-    return mLocations.insert(Loc).second;
+    if (!mNumbering)
+      return getMutable().Locations.insert(Loc).second;
+    auto Idx = mNumbering->getOrInsert(Loc);
+    normalize();
+    if (Idx == LocationDFNumbering::NoIndex)
+      return getMutable().Locations.insert(Loc).second;
+    if (mStorage && mStorage->Dense.test(Idx))
+      return false;
+    getMutable().Dense.set(Idx);
+    return true;
   }
 
   /// Inserts all locations from the range into the value, returns false
@@ -200,7 +497,12 @@ public:
     assert(mKind != INVALID_KIND && "Collection is corrupted!");
     if (mKind == KIND_FULL)
       return false;
-    return mLocations.insert(LocBegin, LocEnd);
+    if (!mNumbering)
+      return getMutable().Locations.insert(LocBegin, LocEnd);
+    bool IsChanged = false;
+    for (location_iterator I = LocBegin; I != LocEnd; ++I)
+      IsChanged |= insert(*I);
+    return IsChanged;
   }
 
   /// Realizes intersection between two values.
@@ -217,7 +519,23 @@ public:
       return true;
     if (mKind != RHS.mKind)
       return false;
-    return mLocations == RHS.mLocations;
+    if (mNumbering != RHS.mNumbering) {
+      LocationSet LHSLocs, RHSLocs;
+      getLocations(LHSLocs);
+      RHS.getLocations(RHSLocs);
+      return LHSLocs == RHSLocs;
+    }
+    normalize();
+    RHS.normalize();
+    if (mStorage == RHS.mStorage)
+      return true;
+    // Empty values are not uniqued, so a uniqued value is never empty.
+    if ((!mStorage || mStorage->isUniqued()) &&
+        (!RHS.mStorage || RHS.mStorage->isUniqued()))
+      return false;
+    if (!mStorage || !RHS.mStorage)
+      return empty() && RHS.empty();
+    return mStorage->isEqual(*RHS.mStorage);
   }
 
   /// Compares two values.
@@ -230,9 +548,48 @@ public:
   /// Support for debugging.
   void dump(const llvm::DominatorTree *DT = nullptr) const;
 
+  /// Specifies a numbering of locations for a value which has not been
+  /// numbered yet.
+  void attach(LocationDFNumbering *N);
+
+  /// Inserts all locations from this value into a specified set.
+  void getLocations(LocationSet &Locs) const;
+
+  /// \brief Shares representation of this value with equal uniqued values.
+  ///
+  /// Only numbered values are uniqued. Equal uniqued values which share
+  /// the same numbering are compared by a pointer.
+  /// This does not change a set of locations, so it is safe to call it for
+  /// constant values.
+  void uniquify() const;
+
 private:
+  /// Moves locations which are based on pointers that became sparse from
+  /// the bit vector to the range-based set and resizes the bit vector
+  /// according to the current size of the numbering.
+  ///
+  /// This does not change a set of locations, so it is safe to call it for
+  /// constant values.
+  void normalize() const;
+
+  /// Returns numbered locations from this value which are based on
+  /// a specified pointer. The value should be normalized.
+  LocationSet getDenseLocations(const llvm::Value *Ptr) const;
+
+  /// \brief Returns representation of locations which is not shared with
+  /// other values.
+  ///
+  /// A representation is created or copied if it is necessary. This method
+  /// is constant because it is also used to normalize constant values.
+  detail::LocationDFStorage & getMutable() const;
+
   Kind mKind;
-  MemorySet<MemoryLocationRange> mLocations;
+  // Representation of locations is destroyed before the numbering it
+  // may be registered in.
+  llvm::IntrusiveRefCntPtr<LocationDFNumbering> mNumbering;
+  // This member is mutable because normalize() and uniquify() replace it
+  // with other representation of the same set of locations.
+  mutable llvm::IntrusiveRefCntPtr<detail::LocationDFStorage> mStorage;
 };
 
 /// \brief This calculates the difference between a set of locations and a set
@@ -43,14 +43,19 @@
 #include <bcl/tagged.h>
 #include <bcl/utility.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Hashing.h>
 #include <llvm/Analysis/AliasSetTracker.h>
+#include <llvm/IR/ValueMap.h>
+#include <llvm/Support/Allocator.h>
 #ifdef LLVM_DEBUG
 # include <llvm/IR/Instruction.h>
 #endif//DEBUG
 #include <llvm/Pass.h>
 
 namespace llvm {
+class BasicBlock;
 class DominatorTree;
 class Value;
 class Instruction;
@@ -59,6 +64,7 @@ class TargetLibraryInfo;
 }
 
 namespace tsar {
+class AliasNode;
 class AliasTree;
 
 /// \brief This contains locations which have outward exposed definitions or
@@ -324,6 +330,76 @@ struct DefinitionInfo {
   LocationDFValue MayReach;
 };
 
+/// \brief Cache of def-use sets of basic blocks which is shared between
+/// different runs of reach definition analysis.
+///
+/// A def-use set of a basic block depends on instructions in the block and on
+/// nodes of an alias tree which may alias locations accessed in the block.
+/// Each set is stored with a structural hash of this information, so the set
+/// is reused if the block has not been changed between analysis stages even
+/// if the alias tree has been rebuilt. Sets are removed from the cache if
+/// a corresponding basic block is deleted or if a set has not been used
+/// during the whole analysis stage (see startStage()).
+class DefUseSummaryCache {
+public:
+  /// Returns a cached def-use set for a specified basic block if it has been
+  /// calculated for a specified structural hash.
+  const DefUseSet * lookup(const llvm::BasicBlock *BB, llvm::hash_code Hash) {
+    auto I = mSummaries.find(BB);
+    if (I == mSummaries.end() || I->second.Hash != Hash)
+      return nullptr;
+    I->second.IsUsed = true;
+    return &I->second.DU;
+  }
+
+  /// \brief Stores a def-use set for a specified basic block.
+  ///
+  /// If `UseInterproc` is set the set depends on results of interprocedural
+  /// analysis and it will be removed at the beginning of the next stage.
+  void insert(const llvm::BasicBlock *BB, llvm::hash_code Hash,
+      const DefUseSet &DU, bool UseInterproc) {
+    auto &S = mSummaries[BB];
+    S.Hash = Hash;
+    S.DU = DU;
+    S.UseInterproc = UseInterproc;
+    S.IsUsed = true;
+  }
+
+  /// \brief Starts a new analysis stage.
+  ///
+  /// This should be called when results of interprocedural analysis are
+  /// recalculated. Def-use sets which depend on these results and sets
+  /// which have not been used since the beginning of the previous stage
+  /// are removed, so the size of the cache is bounded by the number of
+  /// basic blocks analyzed at a single stage.
+  void startStage() {
+    llvm::SmallVector<const llvm::BasicBlock *, 32> ToErase;
+    for (auto S : mSummaries)
+      if (S.second.UseInterproc || !S.second.IsUsed)
+        ToErase.push_back(S.first);
+      else
+        S.second.IsUsed = false;
+    for (auto *BB : ToErase)
+      mSummaries.erase(BB);
+  }
+
+  /// Removes all def-use sets from the cache.
+  void clear() { mSummaries.clear(); }
+
+  /// Returns number of cached def-use sets.
+  unsigned size() const { return mSummaries.size(); }
+
+private:
+  struct Summary {
+    llvm::hash_code Hash;
+    DefUseSet DU;
+    bool UseInterproc = false;
+    bool IsUsed = false;
+  };
+
+  llvm::ValueMap<const llvm::BasicBlock *, Summary> mSummaries;
+};
+
 /// \brief Data-flow framework which is used to find must defined locations
 /// for each natural loops.
 ///
@@ -348,14 +424,52 @@ public:
   /// This covers IN and OUT value for a must/may reach definition analysis.
   typedef DFValue<ReachDFFwk, DefinitionInfo> ReachSet;
 
-  /// This represents results of reach definition analysis results.
-  typedef llvm::DenseMap<DFNode *,
-    std::tuple<std::unique_ptr<DefUseSet>, std::unique_ptr<ReachSet>>,
-    llvm::DenseMapInfo<DFNode *>,
-    tsar::TaggedDenseMapTuple<
-      bcl::tagged<DFNode *, DFNode>,
-      bcl::tagged<std::unique_ptr<DefUseSet>, DefUseSet>,
-      bcl::tagged<std::unique_ptr<ReachSet>, ReachSet>>> DefinedMemoryInfo;
+  /// \brief This represents results of reach definition analysis results.
+  ///
+  /// Def-use sets and reach definitions are allocated in arenas which are
+  /// owned by this map. So, all sets are destroyed at once when the map
+  /// is cleared or destroyed.
+  class DefinedMemoryInfo : public llvm::DenseMap<DFNode *,
+      std::tuple<DefUseSet *, ReachSet *>,
+      llvm::DenseMapInfo<DFNode *>,
+      tsar::TaggedDenseMapTuple<
+        bcl::tagged<DFNode *, DFNode>,
+        bcl::tagged<DefUseSet *, DefUseSet>,
+        bcl::tagged<ReachSet *, ReachSet>>> {
+    typedef llvm::DenseMap<DFNode *,
+      std::tuple<DefUseSet *, ReachSet *>,
+      llvm::DenseMapInfo<DFNode *>,
+      tsar::TaggedDenseMapTuple<
+        bcl::tagged<DFNode *, DFNode>,
+        bcl::tagged<DefUseSet *, DefUseSet>,
+        bcl::tagged<ReachSet *, ReachSet>>> BaseT;
+  public:
+    /// \brief Inserts a specified node with empty def-use set and
+    /// reach definitions.
+    ///
+    /// If the node is already in the map its sets remain unchanged.
+    std::pair<iterator, bool> insertNode(DFNode *N) {
+      auto Pair = BaseT::try_emplace(N);
+      if (Pair.second) {
+        Pair.first->get<DefUseSet>() =
+          new (mDUAllocator.Allocate()) DefUseSet;
+        Pair.first->get<ReachSet>() =
+          new (mRSAllocator.Allocate()) ReachSet;
+      }
+      return Pair;
+    }
+
+    /// Removes all nodes from the map and destroys all allocated sets.
+    void clear() {
+      BaseT::clear();
+      mDUAllocator.DestroyAll();
+      mRSAllocator.DestroyAll();
+    }
+
+  private:
+    llvm::SpecificBumpPtrAllocator<DefUseSet> mDUAllocator;
+    llvm::SpecificBumpPtrAllocator<ReachSet> mRSAllocator;
+  };
 
   /// This represents results of interprocedural analysis.
   typedef llvm::DenseMap<llvm::Function *, std::unique_ptr<DefUseSet>,
@@ -367,14 +481,15 @@ public:
   /// Creates data-flow framework.
   ReachDFFwk(AliasTree &AT, llvm::TargetLibraryInfo &TLI,
       const llvm::DominatorTree *DT, DefinedMemoryInfo &DefInfo) :
-    mAliasTree(&AT), mTLI(&TLI), mDT(DT), mDefInfo(&DefInfo) {}
+    mAliasTree(&AT), mTLI(&TLI), mDT(DT), mDefInfo(&DefInfo),
+    mNumbering(new LocationDFNumbering) {}
 
   /// Creates data-flow framework.
   ReachDFFwk(AliasTree &AT, llvm::TargetLibraryInfo &TLI,
       const llvm::DominatorTree *DT, DefinedMemoryInfo &DefInfo,
       InterprocDefUseInfo &InterprocDUInfo) :
     mAliasTree(&AT), mTLI(&TLI), mDT(DT), mDefInfo(&DefInfo),
-    mInterprocDUInfo(&InterprocDUInfo) {}
+    mInterprocDUInfo(&InterprocDUInfo), mNumbering(new LocationDFNumbering) {}
 
   /// Return results of interprocedural analysis or nullptr.
   InterprocDefUseInfo * getInterprocDefUseInfo() noexcept {
@@ -401,16 +516,73 @@ public:
   /// Returns dominator tree if it is available or nullptr.
   const llvm::DominatorTree * getDomTree() const noexcept { return mDT; }
 
+  /// Returns numbering of locations which is shared between must/may reach
+  /// definitions of all nodes in a function or nullptr if locations are not
+  /// numbered.
+  LocationDFNumbering * getLocationNumbering() const noexcept {
+    return mNumbering.get();
+  }
+
+  /// Disables numbering of locations, so all locations are stored in
+  /// range-based sets. This should be called before the analysis.
+  void disableLocationNumbering() noexcept { mNumbering.reset(); }
+
+  /// Returns collector of statistics of data-flow solvers or nullptr.
+  DataFlowStatistics * getStatistics() const noexcept { return mStatistics; }
+
+  /// Specifies collector of statistics of data-flow solvers.
+  void setStatistics(DataFlowStatistics *Stats) noexcept {
+    mStatistics = Stats;
+  }
+
+  /// Returns true if data-flow problems for acyclic graphs should be also
+  /// solved with the use of a worklist.
+  bool isWorklistForced() const noexcept { return mIsWorklistForced; }
+
+  /// Forces solution of data-flow problems with the use of a worklist.
+  void setWorklistForced(bool IsForced) noexcept {
+    mIsWorklistForced = IsForced;
+  }
+
+  /// Returns cache of def-use sets of basic blocks or nullptr.
+  DefUseSummaryCache * getSummaryCache() const noexcept {
+    return mSummaryCache;
+  }
+
+  /// Specifies cache of def-use sets of basic blocks, if it is not set
+  /// def-use sets are always calculated.
+  void setSummaryCache(DefUseSummaryCache *Cache) noexcept {
+    mSummaryCache = Cache;
+  }
+
+  /// \brief Returns a structural hash of alias nodes which may alias
+  /// a specified one (see for_each_alias()).
+  ///
+  /// Hashes of nodes are memoized, so the whole alias tree is traversed once.
+  llvm::hash_code getAliasHash(AliasNode *AN);
+
   /// Collapses a data-flow graph which represents a region to a one node
   /// in a data-flow graph of an outer region.
   void collapse(DFRegion *R);
 
 private:
+  /// Returns a hash of ancestors of a specified node.
+  llvm::hash_code getAncestorHash(AliasNode *AN);
+
+  /// Returns a hash of a subtree rooted at a specified node.
+  llvm::hash_code getSubtreeHash(AliasNode *AN);
+
   AliasTree *mAliasTree;
   llvm::TargetLibraryInfo *mTLI;
   const llvm::DominatorTree *mDT;
   DefinedMemoryInfo *mDefInfo;
   InterprocDefUseInfo *mInterprocDUInfo = nullptr;
+  DefUseSummaryCache *mSummaryCache = nullptr;
+  DataFlowStatistics *mStatistics = nullptr;
+  bool mIsWorklistForced = false;
+  llvm::IntrusiveRefCntPtr<LocationDFNumbering> mNumbering;
+  llvm::DenseMap<AliasNode *, llvm::hash_code> mAncestorHashes;
+  llvm::DenseMap<AliasNode *, llvm::hash_code> mSubtreeHashes;
 };
 
 /// This represents results of interprocedural reach definition analysis.
@@ -426,16 +598,16 @@ typedef ReachDFFwk::DefinedMemoryInfo DefinedMemoryInfo;
 template<> struct DataFlowTraits<ReachDFFwk *> {
   typedef Forward<DFRegion * > GraphType;
   typedef DefinitionInfo ValueType;
-  static ValueType topElement(ReachDFFwk *, GraphType) {
+  static ValueType topElement(ReachDFFwk *DFF, GraphType) {
     DefinitionInfo DI;
-    DI.MustReach = LocationDFValue::fullValue();
-    DI.MayReach = LocationDFValue::emptyValue();
+    DI.MustReach = LocationDFValue::fullValue(DFF->getLocationNumbering());
+    DI.MayReach = LocationDFValue::emptyValue(DFF->getLocationNumbering());
     return DI;
   }
-  static ValueType boundaryCondition(ReachDFFwk *, GraphType) {
+  static ValueType boundaryCondition(ReachDFFwk *DFF, GraphType) {
     DefinitionInfo DI;
-    DI.MustReach = LocationDFValue::emptyValue();
-    DI.MayReach = LocationDFValue::emptyValue();
+    DI.MustReach = LocationDFValue::emptyValue(DFF->getLocationNumbering());
+    DI.MayReach = LocationDFValue::emptyValue(DFF->getLocationNumbering());
     return DI;
   }
   static void setValue(ValueType V, DFNode *N, ReachDFFwk *DFF) {
@@ -445,6 +617,8 @@ template<> struct DataFlowTraits<ReachDFFwk *> {
     assert(I != DFF->getDefInfo().end() && I->get<ReachSet>() &&
       "Data-flow value must be specified!");
     auto &RS = I->get<ReachSet>();
+    V.MustReach.uniquify();
+    V.MayReach.uniquify();
     RS->setOut(std::move(V));
   }
   static const ValueType & getValue(DFNode *N, ReachDFFwk *DFF) {
@@ -457,6 +631,13 @@ template<> struct DataFlowTraits<ReachDFFwk *> {
     return RS->getOut();
   }
   static void initialize(DFNode *, ReachDFFwk *, GraphType);
+  static DataFlowStatistics * getStatistics(ReachDFFwk *DFF) {
+    return DFF->getStatistics();
+  }
+  static bool isWorklistForced(ReachDFFwk *DFF) {
+    return DFF->isWorklistForced();
+  }
+  static std::size_t size(const ValueType &V) { return V.MayReach.count(); }
   static void meetOperator(
     const ValueType &LHS, ValueType &RHS, ReachDFFwk *, GraphType) {
     RHS.MustReach.intersect(LHS.MustReach);
@@ -480,6 +661,23 @@ template<> struct RegionDFTraits<ReachDFFwk *> :
     return G.Graph->region_end();
   }
 };
+
+/// \brief Finds reach definitions for a specified hierarchy of regions with
+/// the use of sparse def-use chains.
+///
+/// This is an alternative to solveDataFlowUpward() for ReachDFFwk. Locations
+/// are grouped by alias nodes and for each group definitions are propagated
+/// in SSA form through nodes which define locations from this group only.
+/// So, cost of propagation depends on the number of memory accesses instead
+/// of the number of nodes multiplied by the number of locations.
+///
+/// Def-use sets and reach definitions (IN and OUT values) are calculated for
+/// all nodes and regions, results are the same as results of
+/// solveDataFlowUpward(). Values of a node are obtained from values of its
+/// immediate dominator which are updated with phi-versions placed before
+/// the node and with definitions in the node only, so this also does not
+/// depend on the number of groups of locations.
+void solveReachDefinitionsSparsely(ReachDFFwk *DFF, DFRegion *R);
 }
 
 namespace llvm {
@@ -517,5 +715,9 @@ private:
 /// Wrapper to access results of interprocedural reaching definitions analysis.
 using GlobalDefinedMemoryWrapper =
   AnalysisWrapperPass<tsar::InterprocDefUseInfo>;
+
+/// Wrapper to access cache of def-use sets of basic blocks.
+using DefUseSummaryCacheWrapper =
+  AnalysisWrapperPass<tsar::DefUseSummaryCache>;
 }
 #endif//TSAR_DEFINED_MEMORY_H
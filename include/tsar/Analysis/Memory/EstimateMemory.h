@@ -61,17 +61,23 @@
 #include <bcl/IteratorDataAdaptor.h>
 #include <bcl/trait.h>
 #include <bcl/utility.h>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/DepthFirstIterator.h>
 #include <llvm/ADT/DenseMapInfo.h>
 #include <llvm/ADT/GraphTraits.h>
 #include <llvm/ADT/iterator.h>
 #include <llvm/ADT/simple_ilist.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/ADT/TinyPtrVector.h>
 #include <llvm/Analysis/AliasAnalysis.h>
 #include <llvm/Pass.h>
 #include <array>
+#include <cstdint>
 #include <iterator>
+#include <memory>
 #include <tuple>
 #include <vector>
 
@@ -186,10 +192,27 @@ AliasDescriptor aliasRelation(llvm::AAResults &AA, const llvm::DataLayout &DL,
 AliasDescriptor aliasRelation(llvm::AAResults &AA, const llvm::DataLayout &DL,
   const EstimateMemory &LHS, const EstimateMemory &RHS);
 
+/// \brief This determines alias relation of a first memory location to
+/// a second one.
+///
+/// Results of alias queries are cached in a specified alias tree.
+AliasDescriptor aliasRelation(const AliasTree &G, const llvm::DataLayout &DL,
+  const llvm::MemoryLocation &LHS, const llvm::MemoryLocation &RHS);
+
+/// \brief This determines alias relation of a first estimate location to
+/// a second one.
+///
+/// Results of alias queries are cached in a specified alias tree.
+AliasDescriptor aliasRelation(const AliasTree &G, const llvm::DataLayout &DL,
+  const EstimateMemory &LHS, const EstimateMemory &RHS);
+
 /// This determines alias relation between a specified estimate location'EM' and
 /// locations from a specified range [BeginItr, EndItr).
-template<class ItrTy>
-AliasDescriptor aliasRelation(llvm::AAResults &AA, const llvm::DataLayout &DL,
+///
+/// Alias queries are performed with `AA` which is llvm::AAResults or
+/// tsar::AliasTree (in the later case results of queries are cached).
+template<class AnalysisT, class ItrTy>
+AliasDescriptor aliasRelation(AnalysisT &AA, const llvm::DataLayout &DL,
   const EstimateMemory &EM, const ItrTy &BeginItr, const ItrTy &EndItr) {
   auto I = BeginItr;
   auto MergedAD = aliasRelation(AA, DL, EM, *I);
@@ -682,6 +705,15 @@ public:
   /// Merges two nodes with a common parent or an immediate child into a parent.
   void mergeNodeIn(AliasNode &AN, const AliasTree &G);
 
+  /// \brief Returns an identified object (see llvm::isIdentifiedObject())
+  /// which is accessed by all memory locations in this node.
+  ///
+  /// If locations in this node are not bound to a single identified object or
+  /// this node is not an estimate node, this method returns nullptr.
+  const llvm::Value * getUnderlyingObject() const noexcept {
+    return mIsMultiObject ? nullptr : mObject;
+  }
+
   /// \brief Returns true if this node should be ignored as a part of the graph
   /// due to this node has been merged with some other node.
   ///
@@ -705,22 +737,107 @@ public:
     return Dest;
   }
 protected:
+  /// \brief Children of a node partitioned by identified underlying objects.
+  ///
+  /// Children which are not bound to a single identified object
+  /// are mapped to nullptr.
+  using ChildIndex =
+    llvm::DenseMap<const llvm::Value *, llvm::SmallPtrSet<AliasNode *, 2>>;
+
   /// Creates an empty node of a specified kind `K`.
-  explicit AliasNode(Kind K) : mKind(K) {};
+  explicit AliasNode(Kind K) : mKind(K), mIsMultiObject(K != KIND_ESTIMATE) {};
 
   friend AliasTree;
 
   /// Specifies a parent for this node.
   void setParent(AliasNode &Parent, const AliasTree &G) {
     if (mParent) {
-      mParent->mChildren.erase(child_iterator(this));
-      mParent->release(G);
+      auto *OldParent = getParent(G);
+      OldParent->detachChild(*this);
+      OldParent->release(G);
     }
     mParent = &Parent;
-    mParent->mChildren.push_back(*this);
+    mParent->attachChild(*this);
     mParent->retain();
   }
 
+  /// Inserts a specified node at the end of the children list.
+  void attachChild(AliasNode &Child) {
+    mChildren.push_back(Child);
+    Child.mChildOrder = mNextChildOrder++;
+    indexChild(Child);
+  }
+
+  /// Removes a specified node from the children list.
+  void detachChild(AliasNode &Child) {
+    mChildren.erase(child_iterator(Child));
+    unindexChild(Child);
+  }
+
+  /// Inserts a specified child into the index of children.
+  void indexChild(AliasNode &Child) {
+    mChildIndex[Child.getUnderlyingObject()].insert(&Child);
+    ++mNumChildren;
+  }
+
+  /// Removes a specified child from the index of children.
+  void unindexChild(AliasNode &Child) {
+    auto I = mChildIndex.find(Child.getUnderlyingObject());
+    assert(I != mChildIndex.end() && I->second.count(&Child) &&
+      "Index of children is out of date!");
+    I->second.erase(&Child);
+    if (I->second.empty())
+      mChildIndex.erase(I);
+    --mNumChildren;
+  }
+
+  /// \brief Joins a specified object to objects which are accessed by memory
+  /// locations in this node.
+  ///
+  /// If `Object` is nullptr, locations in this node will not be bound to
+  /// a single object any more. Index of children of a parent node is updated.
+  void joinUnderlyingObject(const llvm::Value *Object, const AliasTree &G) {
+    if (mIsMultiObject || Object && Object == mObject)
+      return;
+    auto *Parent = getParent(G);
+    if (Parent)
+      Parent->unindexChild(*this);
+    if (!Object || mObject)
+      mIsMultiObject = true;
+    else
+      mObject = Object;
+    if (Parent)
+      Parent->indexChild(*this);
+  }
+
+  /// \brief Collects children which may alias a location bound to
+  /// a specified identified object.
+  ///
+  /// Other children provably do not alias such location, so it is not
+  /// necessary to ask an alias analysis about them. Children are collected
+  /// in order of the children list. If `Object` is nullptr all children
+  /// are collected.
+  /// \return Number of skipped children.
+  unsigned collectMayAliasChildren(const llvm::Value *Object,
+      llvm::SmallVectorImpl<AliasNode *> &Children) {
+    Children.clear();
+    if (!Object) {
+      for (auto &Ch : mChildren)
+        Children.push_back(&Ch);
+      return 0;
+    }
+    auto I = mChildIndex.find(Object);
+    if (I != mChildIndex.end())
+      Children.append(I->second.begin(), I->second.end());
+    I = mChildIndex.find(nullptr);
+    if (I != mChildIndex.end())
+      Children.append(I->second.begin(), I->second.end());
+    llvm::sort(Children, [](const AliasNode *LHS, const AliasNode *RHS) {
+      return LHS->mChildOrder < RHS->mChildOrder;
+    });
+    return mNumChildren - Children.size();
+  }
+
   /// Increases number of references to this node.
   void retain() const noexcept { ++mRefCount; }
 
@@ -740,24 +857,32 @@ protected:
       "Nodes of the same kind can be merged only!");
     AN.mForward = this;
     retain();
+    for (auto &Ch : AN.mChildren) {
+      Ch.mChildOrder = mNextChildOrder++;
+      indexChild(Ch);
+    }
+    AN.mChildIndex.clear();
+    AN.mNumChildren = 0;
     mChildren.splice(mChildren.end(), AN.mChildren);
-    AN.getParent(G)->mChildren.erase(child_iterator(AN));
+    AN.getParent(G)->detachChild(AN);
+    if (AN.mIsMultiObject || AN.mObject)
+      joinUnderlyingObject(AN.getUnderlyingObject(), G);
   }
 
   /// \brief Checks whether specified estimate locations may alias
   /// one of the members of this node.
   ///
   /// This method is potentially slow because in the worst cast it uses
-  /// AAResults::alias() method to compare all possible pairs of ambiguous
+  /// AliasTree::alias() method to compare all possible pairs of ambiguous
   /// pointers.
   /// \return True in case of alias relation, if a known location is found it
   /// is returned as a second part of a pair.
   std::pair<bool, EstimateMemory *> slowMayAlias(
-    const EstimateMemory &EM, llvm::AAResults &AA);
+    const EstimateMemory &EM, const AliasTree &G);
 
   /// This is a stub for nodes which does not support slowMayAlias().
   std::pair<bool, EstimateMemory *> slowMayAliasImp(
-      const EstimateMemory &/*EM*/, llvm::AAResults &/*AA*/) {
+      const EstimateMemory &/*EM*/, const AliasTree &/*G*/) {
     llvm_unreachable("slowMayAlias() is not implemented for this node!");
     return std::make_pair(false, nullptr);
   }
@@ -783,6 +908,12 @@ protected:
   Kind mKind;
   mutable AliasNode *mParent = nullptr;
   ChildList mChildren;
+  ChildIndex mChildIndex;
+  unsigned mNumChildren = 0;
+  unsigned mChildOrder = 0;
+  unsigned mNextChildOrder = 0;
+  const llvm::Value *mObject = nullptr;
+  bool mIsMultiObject;
   mutable AliasNode *mForward = nullptr;
   mutable unsigned mRefCount = 0;
 };
@@ -853,7 +984,7 @@ private:
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, EstimateMemory *> slowMayAliasImp(
-    const EstimateMemory &EM, llvm::AAResults &AA);
+    const EstimateMemory &EM, const AliasTree &G);
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, llvm::Instruction *> slowMayAliasUnknownImp(
@@ -924,7 +1055,7 @@ private:
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, EstimateMemory *> slowMayAliasImp(
-    const EstimateMemory &EM, llvm::AAResults &AA);
+    const EstimateMemory &EM, const AliasTree &G);
 
   /// Implementation for appropriate function from the base class.
   std::pair<bool, llvm::Instruction *> slowMayAliasUnknownImp(
@@ -933,6 +1064,96 @@ private:
   UnknownList mUnknownInsts;
 };
 
+/// \brief Compact read-only representation of a structure of an alias tree.
+///
+/// Nodes are stored in contiguous arrays in preorder and are referred by
+/// 32-bit indices. Structural properties of nodes (parent, first child and
+/// next sibling) are stored in separate arrays, so traversals of a tree touch
+/// a small amount of memory and do not follow pointers of intrusive lists.
+/// The order of postorder traversal matches the order of llvm::post_order()
+/// for an original tree.
+///
+/// The layout is valid until the alias tree is modified,
+/// see AliasTree::getLayout().
+class AliasTreeLayout {
+public:
+  /// Type of indices of nodes.
+  using index_type = std::uint32_t;
+
+  /// Index which does not refer any node.
+  static constexpr index_type InvalidIndex = ~index_type(0);
+
+  /// This is used to iterate over indices of children of a node.
+  class child_iterator : public llvm::iterator_facade_base<
+      child_iterator, std::forward_iterator_tag, const index_type> {
+  public:
+    child_iterator() = default;
+    child_iterator(const AliasTreeLayout &L, index_type Idx) :
+      mLayout(&L), mIdx(Idx) {}
+
+    bool operator==(const child_iterator &RHS) const noexcept {
+      return mIdx == RHS.mIdx;
+    }
+
+    const index_type & operator*() const noexcept { return mIdx; }
+
+    child_iterator & operator++() {
+      mIdx = mLayout->getNextSibling(mIdx);
+      return *this;
+    }
+
+  private:
+    const AliasTreeLayout *mLayout = nullptr;
+    index_type mIdx = InvalidIndex;
+  };
+
+  /// Builds layout of a specified tree.
+  explicit AliasTreeLayout(const AliasTree &G);
+
+  /// Returns number of nodes in the layout, forwarding nodes are excluded.
+  index_type size() const noexcept { return mNodes.size(); }
+
+  /// Returns node with a specified index.
+  const AliasNode * getNode(index_type Idx) const {
+    assert(Idx < size() && "Index is out of range!");
+    return mNodes[Idx];
+  }
+
+  /// Returns index of a parent or InvalidIndex for the root of a tree.
+  index_type getParent(index_type Idx) const {
+    assert(Idx < size() && "Index is out of range!");
+    return mParents[Idx];
+  }
+
+  /// Returns index of the first child or InvalidIndex for a leaf.
+  index_type getFirstChild(index_type Idx) const {
+    assert(Idx < size() && "Index is out of range!");
+    return mFirstChildren[Idx];
+  }
+
+  /// Returns index of the next sibling or InvalidIndex for the last child.
+  index_type getNextSibling(index_type Idx) const {
+    assert(Idx < size() && "Index is out of range!");
+    return mNextSiblings[Idx];
+  }
+
+  /// Returns indices of children of a specified node.
+  llvm::iterator_range<child_iterator> children(index_type Idx) const {
+    return llvm::make_range(
+      child_iterator(*this, getFirstChild(Idx)), child_iterator());
+  }
+
+  /// Returns indices of nodes in postorder, the root of a tree is the last one.
+  llvm::ArrayRef<index_type> postorder_indices() const { return mPostorder; }
+
+private:
+  std::vector<const AliasNode *> mNodes;
+  std::vector<index_type> mParents;
+  std::vector<index_type> mFirstChildren;
+  std::vector<index_type> mNextSiblings;
+  std::vector<index_type> mPostorder;
+};
+
 class AliasTree {
   /// \brief This chain represents hierarchy of base locations.
   ///
@@ -948,6 +1169,30 @@ class AliasTree {
   /// memory location chains.
   using StrippedMap = llvm::DenseMap<const llvm::Value *, BaseList>;
 
+  /// \brief Map from stripped pointers to generations of lists of bases.
+  ///
+  /// Generation of a list increases on each update of its chains.
+  using GenerationMap = llvm::DenseMap<const llvm::Value *, unsigned>;
+
+  /// \brief Cached result of search for an estimate memory location.
+  ///
+  /// The result is valid while generation of a list of bases for the
+  /// stripped pointer remains unchanged.
+  struct SearchResult {
+    EstimateMemory *EM = nullptr;
+    const llvm::Value *StrippedPtr = nullptr;
+    unsigned Generation = 0;
+  };
+
+  /// \brief Insertion of a memory location which has not changed the tree.
+  ///
+  /// Repeated insertions of the same location do not change the tree while
+  /// generation of a list of bases for the stripped pointer remains unchanged.
+  struct RedundantInsertion {
+    const llvm::Value *StrippedPtr = nullptr;
+    unsigned Generation = 0;
+  };
+
   /// Pool to store pointers to all alias nodes, including forwarding.
   using AliasNodePool = llvm::ilist<AliasNode,
     llvm::ilist_tag<Pool>, llvm::ilist_sentinel_tracking<true>>;
@@ -1031,6 +1276,37 @@ public:
   /// Returns a dominator tree used by this alias tree.
   const llvm::DominatorTree & getDomTree() const noexcept { return *mDT; }
 
+  /// \brief Returns result of an alias query for specified memory locations.
+  ///
+  /// Results of queries are cached until releaseAliasCache() is called,
+  /// subsequent queries are not cached. The number of cached results is
+  /// limited (see -alias-cache-limit), queries are not cached if the cache
+  /// is full.
+  /// Alias relation between memory locations does not depend on a structure of
+  /// this tree, so insertion of locations and merge of nodes do not
+  /// invalidate the cache.
+  llvm::AliasResult alias(const llvm::MemoryLocation &LHS,
+    const llvm::MemoryLocation &RHS) const;
+
+  /// \brief Releases memory allocated for results of alias queries.
+  ///
+  /// This should be called when the tree is constructed because IR may
+  /// be changed after that. Subsequent queries bypass the cache.
+  void releaseAliasCache() {
+    mAliasCache.shrink_and_clear();
+    mUseAliasCache = false;
+  }
+
+  /// \brief Returns compact layout of this tree.
+  ///
+  /// The layout is built on demand and it is reused by subsequent traversals
+  /// until the tree is modified.
+  const AliasTreeLayout & getLayout() const {
+    if (!mLayout)
+      mLayout.reset(new AliasTreeLayout(*this));
+    return *mLayout;
+  }
+
   /// Returns root of the alias tree.
   AliasNode * getTopLevelNode() noexcept { return mTopLevelNode; }
 
@@ -1198,6 +1474,12 @@ private:
   std::tuple<EstimateMemory *, bool, bool>
     insert(const llvm::MemoryLocation &Base);
 
+  /// Returns generation of a list of bases for a specified stripped pointer.
+  unsigned getBaseGeneration(const llvm::Value *StrippedPtr) const {
+    auto I = mBaseGenerations.find(StrippedPtr);
+    return I != mBaseGenerations.end() ? I->second : 0;
+  }
+
   llvm::AAResults *mAA;
   const llvm::DataLayout *mDL;
   const llvm::DominatorTree *mDT;
@@ -1205,7 +1487,14 @@ private:
   AliasNode *mTopLevelNode;
   tsar::AmbiguousRef::AmbiguousPool mAmbiguousPool;
   StrippedMap mBases;
-  mutable llvm::DenseMap<llvm::MemoryLocation, EstimateMemory *> mSearchCache;
+  GenerationMap mBaseGenerations;
+  llvm::DenseMap<llvm::MemoryLocation, RedundantInsertion> mRedundantLocations;
+  mutable llvm::DenseMap<llvm::MemoryLocation, SearchResult> mSearchCache;
+  mutable llvm::DenseMap<
+    std::pair<llvm::MemoryLocation, llvm::MemoryLocation>, llvm::AliasResult>
+      mAliasCache;
+  bool mUseAliasCache = true;
+  mutable std::unique_ptr<AliasTreeLayout> mLayout;
 };
 
 inline void EstimateMemory::setAliasNode(
@@ -1235,17 +1524,17 @@ inline void AliasNode::mergeNodeIn(AliasNode &AN, const AliasTree &G) {
 }
 
 inline std::pair<bool, EstimateMemory *> AliasNode::slowMayAlias(
-    const EstimateMemory &EM, llvm::AAResults &AA) {
+    const EstimateMemory &EM, const AliasTree &G) {
   switch (getKind()) {
   default:
     llvm_unreachable("Unknown kind of an alias node!");
     break;
   case KIND_TOP:
-    return llvm::cast<AliasTopNode>(this)->slowMayAliasImp(EM, AA);
+    return llvm::cast<AliasTopNode>(this)->slowMayAliasImp(EM, G);
   case KIND_ESTIMATE:
-    return llvm::cast<AliasEstimateNode>(this)->slowMayAliasImp(EM, AA);
+    return llvm::cast<AliasEstimateNode>(this)->slowMayAliasImp(EM, G);
   case KIND_UNKNOWN:
-    return llvm::cast<AliasUnknownNode>(this)->slowMayAliasImp(EM, AA);
+    return llvm::cast<AliasUnknownNode>(this)->slowMayAliasImp(EM, G);
   }
 }
 
@@ -0,0 +1,53 @@
+//===- FunctionFingerprint.h - Function Fingerprint Analysis ----*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares storage of analysis results which have been loaded from
+// a cache for functions which have not been changed.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_FUNCTION_FINGERPRINT_H
+#define TSAR_FUNCTION_FINGERPRINT_H
+
+#include "tsar/Support/AnalysisWrapperPass.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
+#include <string>
+
+namespace llvm {
+class Function;
+}
+
+namespace tsar {
+/// Cached results of printed analysis passes for each function which is
+/// marked with AttrKind::CachedResults attribute.
+///
+/// Results are loaded before the function is marked, so results for each of
+/// the requested tags are available for each marked function.
+using FunctionCachedResults =
+  llvm::DenseMap<const llvm::Function *, llvm::StringMap<std::string>>;
+}
+
+namespace llvm {
+/// Wrapper to access analysis results loaded from a cache.
+using FunctionCachedResultsWrapper =
+  AnalysisWrapperPass<tsar::FunctionCachedResults>;
+}
+#endif//TSAR_FUNCTION_FINGERPRINT_H
@@ -0,0 +1,442 @@
+//===- IntervalMemorySet.h - Interval-Based Set of Locations ----*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines storage of memory locations which keeps locations based
+// on the same pointer as a sorted list of disjoint intervals. It provides
+// the same interface as MemorySet, but searches locations with a binary
+// search. So, it is suitable for sets which contain a lot of sections of
+// the same array.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_INTERVAL_MEMORY_SET_H
+#define TSAR_INTERVAL_MEMORY_SET_H
+
+#include "tsar/Analysis/Memory/MemorySetInfo.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/iterator_range.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Metadata.h>
+#include <llvm/IR/Value.h>
+#include <algorithm>
+
+namespace tsar {
+/// \brief This implements a set of memory locations.
+///
+/// This is a replacement for MemorySet which uses the same MemoryInfo traits.
+/// Locations based on the same pointer are coalesced: overlapped and adjoined
+/// locations are merged into a single one, so a list of locations is always
+/// sorted and locations in the list are disjoint. Search of overlapped,
+/// covered and containing locations takes O(log n) time, insertion of a new
+/// location also finds its position in O(log n) time and then shifts
+/// the tail of the list.
+///
+/// Methods of this class do not use alias information. Consequently,
+/// two locations may overlap if they have identical address of beginning.
+template<class LocationTy, class MemoryInfo = MemorySetInfo<LocationTy>>
+class IntervalMemorySet {
+  /// Sorted list of disjoint locations.
+  using LocationList = llvm::SmallVector<LocationTy, 2>;
+
+  /// Map from pointers to locations.
+  using MapTy = llvm::DenseMap<const llvm::Value *, LocationList>;
+public:
+  /// \brief Calculate the difference between two sets of locations.
+  ///
+  /// The result set will contain locations from the first set which are not
+  /// overlapped with any locations from the second set.
+  /// \param [in] LocBegin Iterator that points to the beginning of
+  /// the first location set.
+  /// \param [in] LocEnd Iterator that points to the ending of
+  /// the first location set.
+  /// \param [in] LocSet The second location set.
+  /// \param [out] Result It contains the result of this operation.
+  /// The following operation should be provided:
+  /// - void ResultSet::insert(const LocationTy &)
+  /// - void ResultSet::insert(location_iterator &, location_iterator &)
+  template<class location_iterator, class ResultSet>
+  static void difference(
+    const location_iterator &LocBegin, const location_iterator &LocEnd,
+    const IntervalMemorySet &LocSet, ResultSet &Result) {
+    if (LocSet.mLocations.empty()) {
+      Result.insert(LocBegin, LocEnd);
+    } else {
+      for (location_iterator I = LocBegin; I != LocEnd; ++I)
+        if (!LocSet.overlap(*I))
+          Result.insert(*I);
+    }
+  }
+
+  /// This implements iterator over all memory locations in a set.
+  template<class map_iterator, class value_type> class LocationItr :
+    public std::iterator<std::forward_iterator_tag, value_type> {
+  public:
+    LocationItr(const map_iterator &I, std::size_t Idx) :
+      mCurItr(I), mIdx(Idx) {}
+
+    bool operator==(const LocationItr &RHS) const {
+      return mCurItr == RHS.mCurItr && mIdx == RHS.mIdx;
+    }
+
+    bool operator!=(const LocationItr &RHS) const {
+      return !operator==(RHS);
+    }
+
+    value_type & operator*() const { return mCurItr->second[mIdx]; }
+
+    value_type * operator->() const { return &operator*(); }
+
+    /// Preincrement
+    LocationItr & operator++() {
+      ++mIdx;
+      if (mCurItr->second.size() == mIdx) {
+        ++mCurItr;
+        mIdx = 0;
+      }
+      return *this;
+    }
+
+    /// Postincrement
+    LocationItr operator++(int) {
+      auto tmp = *this; ++*this; return tmp;
+    }
+
+  private:
+    map_iterator mCurItr;
+    std::size_t mIdx;
+  };
+
+  /// This type used to iterate over all locations in this set.
+  using iterator = LocationItr<typename MapTy::iterator, LocationTy>;
+
+  /// This type used to iterate over all locations in this set.
+  using const_iterator =
+    LocationItr<typename MapTy::const_iterator, const LocationTy>;
+
+  /// Return iterator that points to the beginning of locations.
+  iterator begin() { return iterator(mLocations.begin(), 0); }
+
+  /// Return iterator that points to the ending of locations.
+  iterator end() { return iterator(mLocations.end(), 0); }
+
+  /// Return iterator that points to the beginning of locations.
+  const_iterator begin() const { return const_iterator(mLocations.begin(), 0); }
+
+  /// Return iterator that points to the ending of locations.
+  const_iterator end() const { return const_iterator(mLocations.end(), 0); }
+
+  /// Union of returned locations contains a specified location.
+  ///
+  /// Locations in this set are coalesced, so the result contains at most one
+  /// location.
+  template<class Ty>
+  llvm::iterator_range<iterator> findContaining(const Ty &Loc) {
+    auto I = mLocations.find(MemoryInfo::getPtr(Loc));
+    if (I == mLocations.end())
+      return llvm::make_range(end(), end());
+    auto Idx = findContainingIdx(I->second, Loc);
+    if (Idx == I->second.size())
+      return llvm::make_range(end(), end());
+    return llvm::make_range(iterator(I, Idx), std::next(iterator(I, Idx)));
+  }
+
+  /// Union of returned locations contains a specified location.
+  ///
+  /// Locations in this set are coalesced, so the result contains at most one
+  /// location.
+  template<class Ty>
+  llvm::iterator_range<const_iterator> findContaining(const Ty &Loc) const {
+    auto I = mLocations.find(MemoryInfo::getPtr(Loc));
+    if (I == mLocations.end())
+      return llvm::make_range(end(), end());
+    auto Idx = findContainingIdx(I->second, Loc);
+    if (Idx == I->second.size())
+      return llvm::make_range(end(), end());
+    return llvm::make_range(const_iterator(I, Idx),
+                            std::next(const_iterator(I, Idx)));
+  }
+
+  /// Return true if there are locations in this set which contain
+  /// a specified location.
+  template<class Ty> bool contain(const Ty &Loc) const {
+    return findContaining(Loc).begin() != end();
+  }
+
+  /// Find list of locations which are contained in a specified location.
+  template<class Ty> void findCoveredBy(const Ty &Loc,
+      llvm::SmallVectorImpl<LocationTy> &Locs) const {
+    auto I = mLocations.find(MemoryInfo::getPtr(Loc));
+    if (I == mLocations.end())
+      return;
+    for (auto Idx = findOverlappedIdx(I->second, Loc),
+         EIdx = I->second.size(); Idx < EIdx; ++Idx) {
+      auto &Curr = I->second[Idx];
+      if (MemoryInfo::sizecmp(
+              MemoryInfo::getLowerBound(Curr),
+              MemoryInfo::getUpperBound(Loc)) >= 0)
+        return;
+      LocationTy CoveredLoc(Loc);
+      MemoryInfo::setLowerBound(max(MemoryInfo::getLowerBound(Curr),
+                                    MemoryInfo::getLowerBound(Loc)),
+                                CoveredLoc);
+      MemoryInfo::setUpperBound(min(MemoryInfo::getUpperBound(Curr),
+                                    MemoryInfo::getUpperBound(Loc)),
+                                CoveredLoc);
+      Locs.push_back(std::move(CoveredLoc));
+    }
+  }
+
+  /// Return true if there are locations in this set which are contained
+  /// in a specified location.
+  template<class Ty> bool cover(const Ty &Loc) const { return overlap(Loc); }
+
+  /// Return location which may overlap with a specified location.
+  template<class Ty> iterator findOverlappedWith(const Ty &Loc) {
+    auto I = mLocations.find(MemoryInfo::getPtr(Loc));
+    if (I == mLocations.end())
+      return end();
+    auto Idx = findOverlappedIdx(I->second, Loc);
+    if (Idx == I->second.size() ||
+        MemoryInfo::sizecmp(MemoryInfo::getLowerBound(I->second[Idx]),
+                            MemoryInfo::getUpperBound(Loc)) >= 0)
+      return end();
+    return iterator(I, Idx);
+  }
+
+  /// Return location which may overlap with a specified location.
+  template<class Ty> const_iterator findOverlappedWith(const Ty &Loc) const {
+    auto I = mLocations.find(MemoryInfo::getPtr(Loc));
+    if (I == mLocations.end())
+      return end();
+    auto Idx = findOverlappedIdx(I->second, Loc);
+    if (Idx == I->second.size() ||
+        MemoryInfo::sizecmp(MemoryInfo::getLowerBound(I->second[Idx]),
+                            MemoryInfo::getUpperBound(Loc)) >= 0)
+      return end();
+    return const_iterator(I, Idx);
+  }
+
+  /// Return true if there is a location in this set which may overlap
+  /// with a specified location.
+  template<class Ty> bool overlap(const Ty &Loc) const {
+    return findOverlappedWith(Loc) != end();
+  }
+
+  /// Return true if this set does not contain any location.
+  bool empty() const { return mLocations.empty(); }
+
+  /// Removes all locations from this set.
+  void clear() { mLocations.clear(); }
+
+  /// Insert a new location into this set, returns false if it already
+  /// exists.
+  ///
+  /// If the specified value overlaps or adjoins values in this set, they
+  /// will be merged into a single value. In this case, this method also
+  /// returns true.
+  ///
+  /// \attention This method updates AATags for an existing location. So,
+  /// use `sanitizeAAInfo()` method to obtain correct value. Note, that alias
+  /// analysis may not work if AATags is corrupted.
+  template<class Ty> std::pair<iterator, bool> insert(const Ty &Loc) {
+    auto Pair = mLocations.try_emplace(MemoryInfo::getPtr(Loc));
+    auto &List = Pair.first->second;
+    // Find the first location which overlaps or adjoins the new one.
+    auto First = std::partition_point(List.begin(), List.end(),
+      [&Loc](const LocationTy &Curr) {
+        return MemoryInfo::sizecmp(MemoryInfo::getUpperBound(Curr),
+                                   MemoryInfo::getLowerBound(Loc)) < 0;
+      });
+    auto Last = First;
+    while (Last != List.end() &&
+           MemoryInfo::sizecmp(MemoryInfo::getLowerBound(*Last),
+                               MemoryInfo::getUpperBound(Loc)) <= 0)
+      ++Last;
+    auto Idx = std::distance(List.begin(), First);
+    if (First == Last) {
+      List.insert(First, MemoryInfo::make(Loc));
+      return std::make_pair(iterator(Pair.first, Idx), true);
+    }
+    auto &Curr = *First;
+    bool IsChanged = std::next(First) != Last;
+    for (auto I = std::next(First); I != Last; ++I)
+      mergeAATags(MemoryInfo::getAATags(*I), Curr);
+    if (MemoryInfo::getAATags(Curr) != MemoryInfo::getAATags(Loc)) {
+      mergeAATags(MemoryInfo::getAATags(Loc), Curr);
+      IsChanged = true;
+    }
+    auto Upper = max(MemoryInfo::getUpperBound(*std::prev(Last)),
+                     MemoryInfo::getUpperBound(Loc));
+    if (MemoryInfo::sizecmp(MemoryInfo::getUpperBound(Curr), Upper) < 0) {
+      MemoryInfo::setUpperBound(Upper, Curr);
+      IsChanged = true;
+    }
+    if (MemoryInfo::sizecmp(
+            MemoryInfo::getLowerBound(Curr),
+            MemoryInfo::getLowerBound(Loc)) > 0) {
+      MemoryInfo::setLowerBound(MemoryInfo::getLowerBound(Loc), Curr);
+      IsChanged = true;
+    }
+    List.erase(std::next(First), Last);
+    return std::make_pair(iterator(Pair.first, Idx), IsChanged);
+  }
+
+  /// Insert all locations from the range into this set, returns false
+  /// if nothing has been added and updated.
+  template<class location_iterator >
+  bool insert(
+      const location_iterator &LocBegin, const location_iterator &LocEnd) {
+    bool isChanged = false;
+    for (location_iterator I = LocBegin; I != LocEnd; ++I)
+      isChanged = insert(*I).second || isChanged;
+    return isChanged;
+  }
+
+  /// Realize intersection between two sets.
+  template<class SetTy> bool intersect(const SetTy &With) {
+    if (static_cast<const void *>(this) == &With)
+      return false;
+    MapTy PrevLocations;
+    mLocations.swap(PrevLocations);
+    bool IsChanged = false;
+    for (auto &Pair : PrevLocations) {
+      for (auto &Loc : Pair.second) {
+        llvm::SmallVector<LocationTy, 2> CoveredBy;
+        With.findCoveredBy(Loc, CoveredBy);
+        if (CoveredBy.size() != 1 ||
+            MemoryInfo::sizecmp(MemoryInfo::getLowerBound(CoveredBy.front()),
+                                MemoryInfo::getLowerBound(Loc)) != 0 ||
+            MemoryInfo::sizecmp(MemoryInfo::getUpperBound(CoveredBy.front()),
+                                MemoryInfo::getUpperBound(Loc)) != 0)
+          IsChanged = true;
+        insert(CoveredBy.begin(), CoveredBy.end());
+      }
+    }
+    return IsChanged;
+  }
+
+  /// Realize merger between two sets.
+  template<class SetTy> bool merge(const SetTy &With) {
+    if (static_cast<const void *>(this) == &With)
+      return false;
+    bool IsChanged = false;
+    for (auto &Loc : With)
+      IsChanged |= insert(Loc).second;
+    return IsChanged;
+  }
+
+  /// Compare two sets.
+  bool operator!=(const IntervalMemorySet &RHS) const {
+    return !(*this == RHS);
+  }
+
+  /// Compare two sets.
+  ///
+  /// Locations in both sets are coalesced, so it is enough to compare lists
+  /// of locations for each pointer.
+  bool operator==(const IntervalMemorySet &RHS) const {
+    if (this == &RHS)
+      return true;
+    if (mLocations.size() != RHS.mLocations.size())
+      return false;
+    for (auto &Pair : mLocations) {
+      auto I = RHS.mLocations.find(Pair.first);
+      if (I == RHS.mLocations.end() || Pair.second != I->second)
+        return false;
+    }
+    return true;
+  }
+
+private:
+  template<class SizeT>
+  static const SizeT & max(const SizeT &L, const SizeT &R) {
+    if (MemoryInfo::sizecmp(L, R) < 0)
+      return R;
+    return L;
+  }
+  template<class SizeT>
+  static const SizeT & min(const SizeT &L, const SizeT &R) {
+    if (MemoryInfo::sizecmp(L, R) > 0)
+      return R;
+    return L;
+  }
+
+  /// Update metadata of a location which is merged with a location with
+  /// specified metadata.
+  static void mergeAATags(const llvm::AAMDNodes &AATags, LocationTy &Loc) {
+    if (MemoryInfo::getAATags(Loc) == AATags)
+      return;
+    if (MemoryInfo::getAATags(Loc) ==
+        llvm::DenseMapInfo<llvm::AAMDNodes>::getEmptyKey())
+      MemoryInfo::setAATags(AATags, Loc);
+    else
+      MemoryInfo::setAATags(
+        llvm::DenseMapInfo<llvm::AAMDNodes>::getTombstoneKey(), Loc);
+  }
+
+  /// Return index of the first location in a list which ends after
+  /// the beginning of a specified location, or the size of the list.
+  template<class Ty>
+  static std::size_t findOverlappedIdx(const LocationList &List,
+                                       const Ty &Loc) {
+    return std::distance(List.begin(), std::partition_point(
+      List.begin(), List.end(), [&Loc](const LocationTy &Curr) {
+        return MemoryInfo::sizecmp(MemoryInfo::getUpperBound(Curr),
+                                   MemoryInfo::getLowerBound(Loc)) <= 0;
+      }));
+  }
+
+  /// Return index of a location in a list which contains a specified
+  /// location, or the size of the list.
+  template<class Ty>
+  static std::size_t findContainingIdx(const LocationList &List,
+                                       const Ty &Loc) {
+    auto Idx = findOverlappedIdx(List, Loc);
+    if (Idx == List.size() ||
+        MemoryInfo::sizecmp(MemoryInfo::getLowerBound(List[Idx]),
+                            MemoryInfo::getLowerBound(Loc)) > 0 ||
+        MemoryInfo::sizecmp(MemoryInfo::getUpperBound(List[Idx]),
+                            MemoryInfo::getUpperBound(Loc)) < 0)
+      return List.size();
+    return Idx;
+  }
+
+  MapTy mLocations;
+};
+
+/// \brief Calculates the difference between two sets of locations.
+///
+/// \param [in] LocBegin Iterator that points to the beginning of
+/// the first locations set.
+/// \param [in] LocEnd Iterator that points to the ending of
+/// the first locations set.
+/// \param [in] LocSet The second location set.
+/// \param [out] Result It contains the result of this operation.
+/// The following operation should be provided:
+/// - void ResultSet::insert(const LocationTy &)
+/// - void ResultSet::insert(location_iterator &, location_iterator &)
+template<class location_iterator, class Ty, class ResultSet>
+void difference(const location_iterator &LocBegin,
+  const location_iterator &LocEnd,
+  const IntervalMemorySet<Ty> &LocSet, ResultSet &Result) {
+  IntervalMemorySet<Ty>::template difference(LocBegin, LocEnd, LocSet, Result);
+}
+}
+#endif//TSAR_INTERVAL_MEMORY_SET_H
@@ -66,10 +66,37 @@ public:
   DefinedMemoryInfo & getDefInfo() noexcept { return *mDefInfo; }
   const DefinedMemoryInfo & getDefInfo() const noexcept { return *mDefInfo; }
   const llvm::DominatorTree * getDomTree() const noexcept { return mDT; }
+
+  /// Returns collector of statistics of data-flow solvers or nullptr.
+  DataFlowStatistics * getStatistics() const noexcept { return mStatistics; }
+
+  /// Specifies collector of statistics of data-flow solvers.
+  void setStatistics(DataFlowStatistics *Stats) noexcept {
+    mStatistics = Stats;
+  }
+
+  /// Returns true if data-flow problems for acyclic graphs should be also
+  /// solved with the use of a worklist.
+  bool isWorklistForced() const noexcept { return mIsWorklistForced; }
+
+  /// Forces solution of data-flow problems with the use of a worklist.
+  void setWorklistForced(bool IsForced) noexcept {
+    mIsWorklistForced = IsForced;
+  }
+
+  /// Allocates data-flow values for all nodes of a specified region and its
+  /// internal regions.
+  ///
+  /// Initialization of nodes does not change the storage of data-flow values
+  /// after that. So, data-flow problems for sibling regions can be solved
+  /// concurrently.
+  void reserve(DFRegion *R);
 private:
   LiveMemoryInfo *mLiveInfo;
   DefinedMemoryInfo *mDefInfo;
   const llvm::DominatorTree *mDT;
+  DataFlowStatistics *mStatistics = nullptr;
+  bool mIsWorklistForced = false;
 };
 
 /// This covers IN and OUT value for a live locations analysis.
@@ -124,6 +151,15 @@ template<> struct DataFlowTraits<LiveDFFwk *> {
     return LS->getIn();
   }
   static void initialize(DFNode *, LiveDFFwk *, GraphType);
+  static DataFlowStatistics * getStatistics(LiveDFFwk *DFF) {
+    return DFF->getStatistics();
+  }
+  static bool isWorklistForced(LiveDFFwk *DFF) {
+    return DFF->isWorklistForced();
+  }
+  static std::size_t size(const ValueType &V) {
+    return std::distance(V.begin(), V.end());
+  }
   static void meetOperator(
     const ValueType &LHS, ValueType &RHS, LiveDFFwk *, GraphType) {
     RHS.insert(LHS.begin(), LHS.end());
@@ -134,6 +170,9 @@ template<> struct DataFlowTraits<LiveDFFwk *> {
 /// Traits for a data-flow framework which is used to find live locations.
 template<> struct RegionDFTraits<LiveDFFwk *> :
   DataFlowTraits<LiveDFFwk *> {
+  /// Sibling regions can be solved concurrently if values for all nodes
+  /// have been allocated in advance (see LiveDFFwk::reserve()).
+  static constexpr bool IsThreadSafe = true;
   static void expand(LiveDFFwk *, GraphType G) {
     DFNode *LN = G.Graph->getLatchNode();
     if (!LN)
@@ -158,6 +197,22 @@ template<> struct RegionDFTraits<LiveDFFwk *> :
     return G.Graph->region_end();
   }
 };
+
+/// \brief Finds live locations for a specified hierarchy of regions with
+/// the use of bit vectors of a fixed size.
+///
+/// This is a fast path for solveDataFlowDownward() with LiveDFFwk. It is
+/// applicable if locations used in data-flow nodes and locations which are
+/// alive at boundaries of a specified region can be enumerated with a small
+/// number of indices and different locations based on the same pointer do not
+/// overlap. In this case a union of sets never merges locations, so gen/kill
+/// sets are bit vectors and results are the same as results of the general
+/// solver. Results are converted back to LiveSet for each node.
+///
+/// Live sets for the region \p R must be specified before the call.
+/// \return False if the fast path is not applicable, in this case results of
+/// the analysis remain unchanged.
+bool solveLiveMemoryInBits(LiveDFFwk *DFF, DFRegion *R);
 }
 
 namespace llvm {
@@ -191,6 +246,7 @@ public:
   void releaseMemory() override { mLiveInfo.clear(); }
 private:
   tsar::LiveMemoryInfo mLiveInfo;
+  std::unique_ptr<ThreadPool> mPool;
 };
 
 /// Wrapper to access results of interprocedural live memory analysis.
@@ -28,7 +28,9 @@
 #ifndef TSAR_MEMORY_ANALYSIS_PASSES_H
 #define TSAR_MEMORY_ANALYSIS_PASSES_H
 
+#include <llvm/ADT/ArrayRef.h>
 #include <functional>
+#include <string>
 
 namespace tsar {
 class DIMemoryTrait;
@@ -171,6 +173,20 @@ ImmutablePass *createGlobalLiveMemoryStorage();
 /// Initialize a pass to access results of interprocedural live memory analysis.
 void initializeGlobalLiveMemoryWrapperPass(PassRegistry &Registry);
 
+/// Initialize a pass to compute fingerprints of functions.
+void initializeFunctionFingerprintPassPass(PassRegistry &Registry);
+
+/// Initialize a wrapper to access analysis results loaded from a cache.
+void initializeFunctionCachedResultsWrapperPass(PassRegistry &Registry);
+
+/// Create a pass to compute fingerprints of functions.
+///
+/// If incremental analysis is enabled the pass also loads cached results
+/// for each of specified tags and marks functions which results have been
+/// loaded for all tags.
+ModulePass *createFunctionFingerprintPass(
+    ArrayRef<std::string> CacheTags = {});
+
 /// Initialize a pass to perform iterprocedural analysis of defined memory
 /// locations.
 void initializeGlobalDefinedMemoryPass(PassRegistry &Registry);
@@ -191,6 +207,18 @@ ImmutablePass *createGlobalDefinedMemoryStorage();
 /// analysis.
 void initializeGlobalDefinedMemoryWrapperPass(PassRegistry &Registry);
 
+/// Initialize a pass to store def-use sets of basic blocks which are reused
+/// between different runs of reaching definition analysis.
+void initializeDefUseSummaryCacheStoragePass(PassRegistry &Registry);
+
+/// Create a pass to store def-use sets of basic blocks which are reused
+/// between different runs of reaching definition analysis.
+ImmutablePass *createDefUseSummaryCacheStorage();
+
+/// Initialize a pass to access def-use sets of basic blocks which are reused
+/// between different runs of reaching definition analysis.
+void initializeDefUseSummaryCacheWrapperPass(PassRegistry &Registry);
+
 /// Create analysis server.
 ModulePass *createDIMemoryAnalysisServer();
 
@@ -38,6 +38,7 @@ class ImmutablePass;
 class FunctionPass;
 class ModulePass;
 class raw_ostream;
+class StringRef;
 
 /// Initialize base analysis passes.
 void initializeAnalysisBase(PassRegistry &Registry);
@@ -50,6 +51,16 @@ void initializeAnalysisBase(PassRegistry &Registry);
 /// a function pass internal state of which must be printed.
 FunctionPass * createFunctionPassPrinter(const PassInfo *PI, raw_ostream &OS);
 
+/// Create a pass to print internal state of the specified pass after the
+/// last execution.
+///
+/// If incremental analysis is enabled printed results are stored in a cache
+/// of analysis results under a specified tag. Cached results are printed
+/// instead of the internal state for functions marked with
+/// `sapfor.cached-results` attribute.
+FunctionPass * createFunctionPassPrinter(const PassInfo *PI, raw_ostream &OS,
+  StringRef Tag);
+
 /// Create a pass to print internal state of the specified pass after the
 /// last execution.
 ///
@@ -28,8 +28,10 @@
 
 #include "tsar/Frontend/Clang/ASTImportInfo.h"
 #include "tsar/Support/PassGroupRegistry.h"
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/BitmaskEnum.h>
 #include <llvm/ADT/StringRef.h>
+#include <string>
 #include <vector>
 
 namespace llvm {
@@ -37,6 +39,7 @@ class DataLayout;
 class Pass;
 class PassInfo;
 class Module;
+class raw_ostream;
 class raw_pwrite_stream;
 
 namespace legacy {
@@ -74,8 +77,12 @@ void addInitialTransformations(llvm::legacy::PassManager &Passes);
 /// \param AnalysisUse External analysis results which should be used to
 /// clarify analysis. If it is empty GlobalOptions::AnalysisUse value is used
 /// if not empty.
+/// \param CacheTags If it is not empty, fingerprints of functions are computed
+/// after interprocedural analysis and functions which results are cached for
+/// each of these tags are marked, so their analysis is skipped.
 void addBeforeTfmAnalysis(llvm::legacy::PassManager &Passes,
-                          llvm::StringRef AnalysisUse = "");
+                          llvm::StringRef AnalysisUse = "",
+                          llvm::ArrayRef<std::string> CacheTags = {});
 
 /// Perform SROA and repeat variable privatization. After that reduction and
 /// induction recognition will be performed. Flow/anti/output dependencies
@@ -216,12 +223,39 @@ public:
     mPrintSteps(PrintSteps) {}
 
   /// Runs default sequence of passes.
+  ///
+  /// If a directory with persistent results is specified in global options
+  /// (GlobalOptions::AnalysisCache), results of print passes are reused
+  /// for a module which has been already analyzed with the same options.
+  /// Diagnostics are not cached, so results are not stored if some warnings
+  /// or errors have been reported during analysis.
   void run(llvm::Module *M, tsar::TransformationContext *Ctx) override;
 
   /// Initializes external storage to access information about import process.
   ASTImportInfo * initializeImportInfo() override { return &mImportInfo; }
 
+  /// Redirects results of print passes to a specified stream.
+  ///
+  /// LLVM diagnostics (except errors) and warnings of the query manager are
+  /// also redirected to this stream.
+  /// By default results are printed to the standard error stream. This is
+  /// useful to collect results for a single input if multiple inputs are
+  /// processed concurrently.
+  void setOutputStream(llvm::raw_ostream &OS) noexcept { mOutput = &OS; }
+
 private:
+  /// Returns stream to print results of print passes.
+  llvm::raw_ostream & getOutputStream() const;
+
+  /// Runs default sequence of passes without access to persistent results.
+  void runPasses(llvm::Module *M, tsar::TransformationContext *Ctx);
+
+  /// Returns true if a specified step must be performed to obtain results
+  /// of all requested steps.
+  ///
+  /// Steps after the last requested one are not scheduled at all.
+  bool isStepNecessary(ProcessingStep Step) const;
+
   /// Updates pass manager. Adds a specified pass and a pass to print its result
   // if `PrintResult` is set to 'true`.
   void addWithPrint(llvm::Pass *P, bool PrintResult,
@@ -231,8 +265,9 @@ private:
   PassList mOutputPasses;
   PassList mPrintPasses;
   ProcessingStep mPrintSteps;
-  const GlobalOptions *mGlobalOptions;
+  const GlobalOptions *mGlobalOptions = nullptr;
   ASTImportInfo mImportInfo;
+  llvm::raw_ostream *mOutput = nullptr;
 };
 
 /// This prints LLVM IR to the standard output stream.
@@ -29,7 +29,9 @@
 
 #include "tsar/Support/GlobalOptions.h"
 #include <bcl/utility.h>
+#include <clang/Basic/FileManager.h>
 #include <clang/Tooling/CompilationDatabase.h>
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/SmallVector.h>
 #include <string>
 #include <vector>
@@ -96,6 +98,36 @@ private:
   ///
   void storePrintOptions(OptionList &IncompatibleOpts);
 
+  /// \brief Performs default analysis of independent translation units
+  /// concurrently.
+  ///
+  /// Each source is processed by a separate worker which owns its own
+  /// compiler instance, LLVM context and query manager. Diagnostics and
+  /// results of analysis are collected for each source separately and
+  /// are printed in order of sources when all workers have finished.
+  /// Clang diagnostics, LLVM diagnostics (except errors, which terminate
+  /// the process) and results of print passes are collected. Debug output
+  /// (-debug, -debug-only) is not collected and may be interleaved.
+  ///
+  /// Workers share the following process-wide state:
+  /// - command line options and global options, they are only read after
+  ///   command line has been parsed in the constructor of this tool;
+  /// - the pass registry and registries of pass groups, all passes are
+  ///   registered in the constructor before command line is parsed, so
+  ///   initialize...Pass() calls from workers do not change registries
+  ///   (initialization is performed once with llvm::call_once(), and the pass
+  ///   registry is also guarded by a lock);
+  /// - statistics, LLVM updates their values atomically and registers them
+  ///   under a lock;
+  /// - the pass profiler, it guards its records with a lock;
+  /// - the persistent cache of results, entries are written to temporary
+  ///   files which are renamed then.
+  /// \param [in] Sources List of all sources excluding LLVM IR files.
+  /// \param [in] LLSources List of LLVM IR sources.
+  /// \return Zero on success.
+  int runConcurrently(llvm::ArrayRef<std::string> Sources,
+                      llvm::ArrayRef<std::string> LLSources);
+
   GlobalOptions mGlobalOpts;
   std::vector<std::string> mCommandLine;
   std::vector<std::string> mSources;
@@ -105,6 +137,8 @@ private:
   uint8_t mPrintSteps = 0;
   const llvm::PassInfo * mTfmPass;
   std::unique_ptr<clang::tooling::CompilationDatabase> mCompilations;
+  /// File manager which is shared between sources analyzed sequentially.
+  llvm::IntrusiveRefCntPtr<clang::FileManager> mFiles;
   bool mEmitAST = false;
   bool mMergeAST = false;
   bool mPrintAST = false;
@@ -114,7 +148,11 @@ private:
   bool mCheck = false;
   bool mPrint = false;
   bool mServer = false;
+  /// Number of translation units which can be analyzed concurrently.
+  unsigned mJobs = 1;
   std::string mOutputFilename;
+  /// Name of a file to write profile of passes to.
+  std::string mProfileFilename;
   std::string mLanguage;
   std::string mInstrEntry;
   std::vector<std::string> mInstrStart;
@@ -166,6 +166,14 @@ public:
   /// Returns true if transformation engine is configured.
   bool hasInstance() const { return mGen && mCtx && mCI; }
 
+  /// Returns number of warnings and errors which have been reported so far.
+  unsigned getNumReportedDiagnostics() {
+    if (!hasInstance())
+      return 0;
+    auto *Client = mRewriter.getSourceMgr().getDiagnostics().getClient();
+    return Client ? Client->getNumWarnings() + Client->getNumErrors() : 0;
+  }
+
   /// Returns true if modifications have been made to some files.
   bool hasModification() const {
     return hasInstance() &&
@@ -0,0 +1,89 @@
+//===--- AnalysisCache.h ---- Persistent Analysis Results -------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a content-addressed on-disk storage of analysis results.
+// Results for a translation unit are keyed by a hash of LLVM IR which has been
+// generated for this unit before any transformation, by options which
+// influence analysis and by a version of TSAR. The LLVM IR is produced from
+// a preprocessed translation unit and contains debug information, so it
+// changes whenever the preprocessed translation unit changes. Results for
+// a single function are keyed by a function fingerprint
+// (see FunctionFingerprintPass) instead of the whole LLVM IR.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_ANALYSIS_CACHE_H
+#define TSAR_ANALYSIS_CACHE_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/StringRef.h>
+#include <string>
+
+namespace llvm {
+class Module;
+}
+
+namespace tsar {
+struct GlobalOptions;
+
+/// Content-addressed on-disk cache of analysis results.
+///
+/// Each entry is stored in a separate file in a cache directory, the name of
+/// the file is a key of the entry. Entries are written atomically, so multiple
+/// processes (or threads) may share the same cache directory.
+class AnalysisCache {
+public:
+  /// Creates cache which stores entries in a specified directory.
+  explicit AnalysisCache(llvm::StringRef Dir) : mDir(Dir) {}
+
+  /// Computes a key for results of analysis of a specified module.
+  ///
+  /// \param [in] M Module which has been generated for a translation unit,
+  /// it must not be transformed yet.
+  /// \param [in] GO Global options, only options which influence analysis
+  /// results are taken into account.
+  /// \param [in] Config Any other description of a pipeline which produces
+  /// results, for example names of passes which results are printed.
+  static std::string computeKey(const llvm::Module &M,
+    const GlobalOptions &GO, llvm::ArrayRef<std::string> Config);
+
+  /// Computes a key for results of analysis of a function with a specified
+  /// fingerprint.
+  static std::string computeKey(llvm::StringRef Fingerprint,
+    const GlobalOptions &GO, llvm::ArrayRef<std::string> Config);
+
+  /// Returns cached results for a specified key if they exist.
+  llvm::Optional<std::string> lookup(llvm::StringRef Key) const;
+
+  /// Returns true if there are cached results for a specified key.
+  bool contains(llvm::StringRef Key) const;
+
+  /// Stores results for a specified key, returns `false` on failure.
+  bool store(llvm::StringRef Key, llvm::StringRef Results) const;
+
+  /// Returns directory which contains cached results.
+  llvm::StringRef getDirectory() const noexcept { return mDir; }
+
+private:
+  std::string mDir;
+};
+}
+#endif//TSAR_ANALYSIS_CACHE_H
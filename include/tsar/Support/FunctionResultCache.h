@@ -0,0 +1,177 @@
+//===- FunctionResultCache.h - Cache of Per-Function Results ----*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a memoizing cache of results which are computed for
+// functions with the use of a function pass provider (see PassProvider.h).
+//
+// Results of function passes are owned by passes in the on-the-fly pass
+// manager, so they are overwritten when a provider is executed for another
+// function. So, each getAnalysis<Provider>(F) call from a module pass
+// re-executes all provided passes. If a module pass accesses the same
+// function many times (for example, to answer similar requests), it should
+// extract necessary information from a provider and store it in this cache.
+// Note, that the cache does not track changes of functions, so it should be
+// used only if analyzed functions are not changed. The total size of cached
+// results may be limited, in this case the least recently used results are
+// evicted.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_FUNCTION_RESULT_CACHE_H
+#define TSAR_FUNCTION_RESULT_CACHE_H
+
+#include <bcl/utility.h>
+#include <llvm/ADT/DenseMap.h>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <string>
+#include <utility>
+
+namespace llvm {
+class Function;
+}
+
+namespace tsar {
+/// Estimates amount of memory which is occupied by a cached result.
+///
+/// Specialize this template to obtain more accurate estimation for results
+/// which own dynamically allocated memory.
+template<class ResultT> struct FunctionResultSize {
+  static std::size_t get(const ResultT &) { return sizeof(ResultT); }
+};
+
+template<> struct FunctionResultSize<std::string> {
+  static std::size_t get(const std::string &R) {
+    return sizeof(std::string) + R.capacity();
+  }
+};
+
+/// Memoizing cache of per-function results with LRU eviction.
+///
+/// Each result is identified by a function and an additional key which
+/// distinguishes different results for the same function (for example,
+/// results for different loops). Results which do not relate to a single
+/// function are stored for `nullptr` function.
+template<class ResultT, class SizeT = FunctionResultSize<ResultT>>
+class FunctionResultCache : private bcl::Uncopyable {
+  using KeyT = std::pair<const llvm::Function *, std::uintptr_t>;
+
+  struct Entry {
+    KeyT Key;
+    ResultT Result;
+    std::size_t Size;
+  };
+
+  using EntryList = std::list<Entry>;
+
+public:
+  /// Creates cache which stores at most `MemoryLimit` bytes of results
+  /// (0 means unlimited cache).
+  explicit FunctionResultCache(std::size_t MemoryLimit = 0)
+    : mMemoryLimit(MemoryLimit) {}
+
+  /// Returns cached result for a specified function or `nullptr` if it is
+  /// not available.
+  ///
+  /// \param [in] F Function which result should be obtained, it may be
+  /// `nullptr` for results which depend on the whole module.
+  /// \param [in] SubKey Additional key to distinguish different results for
+  /// the same function.
+  const ResultT * lookup(const llvm::Function *F, std::uintptr_t SubKey) {
+    auto I = mIndex.find(KeyT(F, SubKey));
+    if (I == mIndex.end()) {
+      ++mNumMisses;
+      return nullptr;
+    }
+    ++mNumHits;
+    mEntries.splice(mEntries.begin(), mEntries, I->second);
+    return &I->second->Result;
+  }
+
+  /// Stores a computed result for a specified function and returns it.
+  ///
+  /// The least recently used results are evicted if the memory limit is
+  /// exceeded, however the just stored result is never evicted.
+  const ResultT & insert(const llvm::Function *F, std::uintptr_t SubKey,
+      ResultT Result) {
+    KeyT Key(F, SubKey);
+    auto I = mIndex.find(Key);
+    if (I != mIndex.end())
+      erase(I->second);
+    mEntries.push_front(Entry{ Key, std::move(Result), 0 });
+    auto &E = mEntries.front();
+    E.Size = SizeT::get(E.Result);
+    mSize += E.Size;
+    mIndex.try_emplace(Key, mEntries.begin());
+    shrink();
+    return E.Result;
+  }
+
+  /// Sets memory limit (0 means unlimited cache) and evicts the least
+  /// recently used results if it is exceeded.
+  void setMemoryLimit(std::size_t MemoryLimit) {
+    mMemoryLimit = MemoryLimit;
+    shrink();
+  }
+
+  /// Evicts all results.
+  void clear() {
+    mEntries.clear();
+    mIndex.clear();
+    mSize = 0;
+  }
+
+  /// Returns number of cached results.
+  std::size_t size() const noexcept { return mEntries.size(); }
+
+  /// Returns estimated amount of memory occupied by cached results.
+  std::size_t getMemorySize() const noexcept { return mSize; }
+
+  /// Returns memory limit (0 means unlimited cache).
+  std::size_t getMemoryLimit() const noexcept { return mMemoryLimit; }
+
+  /// Returns number of requests which have been answered from the cache.
+  unsigned getNumHits() const noexcept { return mNumHits; }
+
+  /// Returns number of requests which required computation of results.
+  unsigned getNumMisses() const noexcept { return mNumMisses; }
+
+private:
+  void erase(typename EntryList::iterator I) {
+    mSize -= I->Size;
+    mIndex.erase(I->Key);
+    mEntries.erase(I);
+  }
+
+  void shrink() {
+    while (mMemoryLimit > 0 && mSize > mMemoryLimit && mEntries.size() > 1)
+      erase(std::prev(mEntries.end()));
+  }
+
+  EntryList mEntries;
+  llvm::DenseMap<KeyT, typename EntryList::iterator> mIndex;
+  std::size_t mSize = 0;
+  std::size_t mMemoryLimit;
+  unsigned mNumHits = 0;
+  unsigned mNumMisses = 0;
+};
+}
+#endif//TSAR_FUNCTION_RESULT_CACHE_H
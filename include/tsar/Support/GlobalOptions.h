@@ -66,6 +66,29 @@ struct GlobalOptions {
   std::string OutputSuffix = "";
   /// Disable formatting of a source code after transformation.
   bool NoFormat = false;
+  /// Directory with persistent results of analysis which should be reused
+  /// if a translation unit has not been changed.
+  std::string AnalysisCache = "";
+  /// Reuse results of analysis for unchanged functions if a translation unit
+  /// has been changed (AnalysisCache must be set).
+  bool IncrementalAnalysis = false;
+  /// Number of threads to solve data-flow problems for sibling regions
+  /// concurrently (zero means that problems are solved sequentially).
+  unsigned DataFlowThreads = 0;
+  /// Use sparse def-use chains over alias nodes to find reach definitions.
+  bool SparseReachDefinitions = false;
+  /// Solve data-flow problems with a worklist for acyclic graphs too (this
+  /// is used to check that different solvers produce the same results).
+  bool DataFlowWorklist = false;
+  /// Do not number locations in reach definition analysis, so all locations
+  /// are stored in range-based sets.
+  bool NoLocationNumbering = false;
+  /// Do not solve live memory problems with the use of bit vectors (this
+  /// is used to check the general and concurrent solvers).
+  bool NoLiveMemoryBits = false;
+  /// Maximum amount of memory (in megabytes) which is occupied by answers
+  /// cached in the analysis server (zero means unlimited cache).
+  unsigned AnswerCacheLimit = 64;
 };
 }
 
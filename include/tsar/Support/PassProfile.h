@@ -0,0 +1,158 @@
+//===--- PassProfile.h --- Per-Pass Profile of Analysis ---------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a profiler which records time and memory consumed by
+// each execution of a pass for each function. Unlike LLVM pass timers
+// (-ftime-report) results are not aggregated, so it is possible to find out
+// which function makes some pass to be too expensive. Passes should explicitly
+// mark regions to be profiled and specify some size counters (for example,
+// number of nodes in an alias tree) which explain consumed resources.
+//
+// The profile is written in JSON format. It is also written in Chrome
+// trace-event format, so it can be inspected in a trace viewer
+// (chrome://tracing, Perfetto UI).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TSAR_PASS_PROFILE_H
+#define TSAR_PASS_PROFILE_H
+
+#include <bcl/utility.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class Function;
+class Pass;
+}
+
+namespace tsar {
+class DataFlowStatistics;
+
+/// Storage of recorded executions of passes.
+///
+/// This is a singleton, it is thread-safe to record executions of passes from
+/// different threads.
+class PassProfiler : private bcl::Uncopyable {
+public:
+  using CounterList =
+    llvm::SmallVector<std::pair<std::string, std::uint64_t>, 4>;
+
+  /// Execution of a pass for a function.
+  struct Record {
+    std::string Pass;
+    std::string Function;
+    std::uint64_t Thread;
+    /// Start time in microseconds from the start of profiling.
+    std::uint64_t Start;
+    /// Wall time in microseconds.
+    std::uint64_t Duration;
+    /// Change of resident set size in bytes.
+    std::int64_t RSSDelta;
+    CounterList Counters;
+  };
+
+  /// Returns profiler.
+  static PassProfiler & get();
+
+  /// Returns true if profiling is enabled.
+  ///
+  /// Profiling should be enabled before passes are executed.
+  bool isEnabled() const noexcept { return mIsEnabled; }
+
+  /// Enables profiling.
+  void enable();
+
+  /// Returns number of microseconds since the start of profiling.
+  std::uint64_t now() const;
+
+  /// Adds a new record to the profile.
+  void add(Record &&R);
+
+  /// Returns all recorded executions.
+  std::vector<Record> getRecords() const;
+
+  /// Writes profile in JSON format to a specified file and Chrome trace-event
+  /// file to a file with the same name followed by '.trace.json' suffix.
+  ///
+  /// \return False if some of files can not be written.
+  bool write(llvm::StringRef Filename) const;
+
+private:
+  PassProfiler() = default;
+
+  bool mIsEnabled = false;
+  std::chrono::steady_clock::time_point mStart;
+  mutable std::mutex mMutex;
+  std::vector<Record> mRecords;
+};
+
+/// Returns current resident set size of a process in bytes.
+///
+/// If it is not available on a host the number of allocated bytes is returned.
+std::size_t getResidentSetSize();
+
+/// Profiled region of a pass execution.
+///
+/// The region starts on construction and it is recorded on destruction if
+/// profiling is enabled.
+class PassProfileRegion : private bcl::Uncopyable {
+public:
+  /// Starts execution of a specified pass for a function (or for a whole
+  /// module if function is `nullptr`).
+  PassProfileRegion(const llvm::Pass &P, const llvm::Function *F);
+
+  /// Records execution of a pass.
+  ~PassProfileRegion();
+
+  /// Returns true if the region should be recorded.
+  ///
+  /// Counters which are expensive to compute should be calculated only if
+  /// this method returns true.
+  explicit operator bool() const noexcept { return mIsActive; }
+
+  /// Specifies value of a size counter.
+  void addCounter(llvm::StringRef Name, std::uint64_t Value) {
+    if (mIsActive)
+      mRecord.Counters.emplace_back(Name.str(), Value);
+  }
+
+private:
+  bool mIsActive;
+  std::size_t mRSS = 0;
+  PassProfiler::Record mRecord;
+};
+
+/// Returns true if statistics of data-flow solvers should be collected
+/// for a specified profiled region.
+bool isDataFlowStatisticsRequested(const PassProfileRegion &Profile);
+
+/// Accounts statistics of data-flow solvers in LLVM statistics and in counters
+/// of a specified profiled region.
+void reportDataFlowStatistics(const DataFlowStatistics &Stats,
+  PassProfileRegion &Profile);
+}
+#endif//TSAR_PASS_PROFILE_H
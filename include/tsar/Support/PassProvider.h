@@ -36,6 +36,10 @@
 // initialize a such passes.
 //
 // To avoid this problems a provider pass could be used.
+//
+// Note, that a provider does not keep results for different functions. Each
+// getAnalysis<Provider>(F) call re-executes provided passes. To reuse results
+// which have been computed for a function use FunctionResultCache.
 //===----------------------------------------------------------------------===//
 
 #ifndef TSAR_PASS_PROVIDER_H
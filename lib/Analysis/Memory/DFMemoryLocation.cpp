@@ -33,16 +33,175 @@
 using namespace llvm;
 
 namespace tsar {
+unsigned LocationDFNumbering::getOrInsert(const MemoryLocationRange &Loc) {
+  using MemoryInfo = MemorySetInfo<MemoryLocationRange>;
+  auto &Info = mPointers[Loc.Ptr];
+  if (Info.IsSparse)
+    return NoIndex;
+  for (auto Idx : Info.Numbers) {
+    auto &Curr = mLocations[Idx];
+    if (Curr == Loc)
+      return Idx;
+    // Locations which overlap or adjoin each other are merged in
+    // a range-based set, so they can not be represented as separate bits.
+    if (MemoryInfo::sizecmp(Curr.UpperBound, Loc.LowerBound) >= 0 &&
+        MemoryInfo::sizecmp(Curr.LowerBound, Loc.UpperBound) <= 0) {
+      mSparseNumbers.resize(mLocations.size());
+      for (auto SparseIdx : Info.Numbers)
+        mSparseNumbers.set(SparseIdx);
+      Info.Numbers.clear();
+      Info.IsSparse = true;
+      ++mEpoch;
+      return NoIndex;
+    }
+  }
+  Info.Numbers.push_back(mLocations.size());
+  mLocations.push_back(Loc);
+  return Info.Numbers.back();
+}
+
+detail::LocationDFStorage * LocationDFNumbering::getUniqued(
+    detail::LocationDFStorage *S) {
+  assert(S && "Representation must not be null!");
+  assert(!S->isUniqued() && "Representation has been already uniqued!");
+  S->mHash = S->computeHash();
+  auto Pair = mUniqued.insert(S);
+  if (Pair.second)
+    S->mUniquer = this;
+  return *Pair.first;
+}
+
+void LocationDFValue::attach(LocationDFNumbering *N) {
+  assert(mKind != INVALID_KIND && "Collection is corrupted!");
+  assert((!mNumbering || mNumbering == N) &&
+    "Numbering has been already specified!");
+  if (mNumbering == N)
+    return;
+  mNumbering = N;
+  if (mKind == KIND_FULL || !mStorage)
+    return;
+  // Values which are not numbered are never uniqued.
+  auto Storage = std::move(mStorage);
+  insert(Storage->Locations.begin(), Storage->Locations.end());
+}
+
+detail::LocationDFStorage & LocationDFValue::getMutable() const {
+  if (!mStorage) {
+    mStorage = new detail::LocationDFStorage;
+    if (mNumbering) {
+      mStorage->Dense.resize(mNumbering->size());
+      mStorage->Epoch = mNumbering->getEpoch();
+    }
+  } else if (!mStorage->isUnique()) {
+    mStorage = new detail::LocationDFStorage(*mStorage);
+  }
+  return *mStorage;
+}
+
+void LocationDFValue::normalize() const {
+  if (!mNumbering || !mStorage)
+    return;
+  if (mStorage->Epoch != mNumbering->getEpoch()) {
+    auto &Sparse = mNumbering->getSparseNumbers();
+    if (mStorage->Dense.anyCommon(Sparse)) {
+      // Sparse locations are moved to a copy of the representation because
+      // the uniqued representation may be shared with other values.
+      bool IsUniqued = mStorage->isUniqued();
+      auto &S = getMutable();
+      for (auto Idx : S.Dense.set_bits())
+        if (Idx < Sparse.size() && Sparse.test(Idx))
+          S.Locations.insert((*mNumbering)[Idx]);
+      S.Dense.reset(Sparse);
+      S.Epoch = mNumbering->getEpoch();
+      if (S.Dense.size() != mNumbering->size())
+        S.Dense.resize(mNumbering->size());
+      if (IsUniqued)
+        uniquify();
+      return;
+    }
+    // The representation is not changed, so it is safe to update it
+    // in place even if it is shared.
+    mStorage->Epoch = mNumbering->getEpoch();
+  }
+  if (mStorage->Dense.size() != mNumbering->size())
+    mStorage->Dense.resize(mNumbering->size());
+}
+
+void LocationDFValue::uniquify() const {
+  assert(mKind != INVALID_KIND && "Collection is corrupted!");
+  if (!mNumbering || !mStorage || mStorage->isUniqued())
+    return;
+  normalize();
+  if (mStorage->Locations.empty() && mStorage->Dense.none()) {
+    mStorage = nullptr;
+    return;
+  }
+  mStorage = mNumbering->getUniqued(mStorage.get());
+}
+
+LocationDFValue::LocationSet LocationDFValue::getDenseLocations(
+    const Value *Ptr) const {
+  assert(mNumbering && "Numbering must not be null!");
+  LocationSet Locs;
+  if (!mStorage)
+    return Locs;
+  for (auto Idx : mNumbering->getNumbers(Ptr))
+    if (mStorage->Dense.test(Idx))
+      Locs.insert((*mNumbering)[Idx]);
+  return Locs;
+}
+
+void LocationDFValue::getLocations(LocationSet &Locs) const {
+  assert(mKind != INVALID_KIND && "Collection is corrupted!");
+  if (!mStorage)
+    return;
+  normalize();
+  Locs.insert(mStorage->Locations.begin(), mStorage->Locations.end());
+  if (!mNumbering)
+    return;
+  for (auto Idx : mStorage->Dense.set_bits())
+    Locs.insert((*mNumbering)[Idx]);
+}
+
 bool LocationDFValue::intersect(const LocationDFValue &With) {
   assert(mKind != INVALID_KIND && "Collection is corrupted!");
   assert(With.mKind != INVALID_KIND && "Collection is corrupted!");
   if (With.mKind == KIND_FULL)
     return false;
   if (mKind == KIND_FULL) {
+    auto Numbering = mNumbering;
     *this = With;
+    if (!mNumbering && Numbering)
+      attach(Numbering.get());
     return true;
   }
-  return mLocations.intersect(With.mLocations);
+  if (!mNumbering && With.mNumbering)
+    attach(With.mNumbering.get());
+  if (mNumbering != With.mNumbering) {
+    LocationSet Locs;
+    With.getLocations(Locs);
+    auto Tmp = emptyValue(mNumbering.get());
+    Tmp.insert(Locs.begin(), Locs.end());
+    return intersect(Tmp);
+  }
+  normalize();
+  With.normalize();
+  if (mStorage == With.mStorage || !mStorage)
+    return false;
+  if (!With.mStorage) {
+    bool IsChanged = !empty();
+    clear();
+    return IsChanged;
+  }
+  // Keep the shared representation if nothing has been changed.
+  auto Old = mStorage;
+  auto &S = getMutable();
+  bool IsChanged = S.Dense.test(With.mStorage->Dense);
+  S.Dense &= With.mStorage->Dense;
+  IsChanged |= S.Locations.intersect(With.mStorage->Locations);
+  if (!IsChanged)
+    mStorage = std::move(Old);
+  return IsChanged;
 }
 
 bool LocationDFValue::merge(const LocationDFValue &With) {
@@ -51,11 +210,34 @@ bool LocationDFValue::merge(const LocationDFValue &With) {
   if (mKind == KIND_FULL)
     return false;
   if (With.mKind == KIND_FULL) {
-    mLocations.clear();
+    mStorage = nullptr;
     mKind = KIND_FULL;
     return true;
   }
-  return mLocations.merge(With.mLocations);
+  if (!mNumbering && With.mNumbering)
+    attach(With.mNumbering.get());
+  if (mNumbering != With.mNumbering) {
+    LocationSet Locs;
+    With.getLocations(Locs);
+    return insert(Locs.begin(), Locs.end());
+  }
+  normalize();
+  With.normalize();
+  if (mStorage == With.mStorage || !With.mStorage)
+    return false;
+  if (!mStorage) {
+    mStorage = With.mStorage;
+    return !empty();
+  }
+  // Keep the shared representation if nothing has been changed.
+  auto Old = mStorage;
+  auto &S = getMutable();
+  bool IsChanged = With.mStorage->Dense.test(S.Dense);
+  S.Dense |= With.mStorage->Dense;
+  IsChanged |= S.Locations.merge(With.mStorage->Locations);
+  if (!IsChanged)
+    mStorage = std::move(Old);
+  return IsChanged;
 }
 
 void LocationDFValue::print(raw_ostream &OS, const DominatorTree *DT) const {
@@ -63,7 +245,9 @@ void LocationDFValue::print(raw_ostream &OS, const DominatorTree *DT) const {
     OS << "whole program memory\n";
     return;
   }
-  for (auto &Loc: mLocations) {
+  LocationSet Locations;
+  getLocations(Locations);
+  for (auto &Loc: Locations) {
     printLocationSource(OS, Loc.Ptr, DT);
     OS << " " << *Loc.Ptr << "\n";
   }
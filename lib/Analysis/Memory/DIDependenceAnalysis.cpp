@@ -41,6 +41,7 @@
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/IRUtils.h"
 #include "tsar/Support/MetadataUtils.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Support/Tags.h"
 #include "tsar/Support/Utils.h"
 #include "tsar/Unparse/SourceUnparser.h"
@@ -1926,6 +1927,10 @@ bool DIDependencyAnalysisPass::runOnFunction(Function &F) {
   auto &GlobalOpts = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
   if (!GlobalOpts.AnalyzeLibFunc && hasFnAttr(F, AttrKind::LibFunc))
     return false;
+  // Printed results of analysis for this function are available in a cache.
+  if (hasFnAttr(F, AttrKind::CachedResults))
+    return false;
+  PassProfileRegion Profile(*this, &F);
   mDT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
   mSE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
   mAT = &getAnalysis<EstimateMemoryPass>().getAliasTree();
@@ -1942,6 +1947,9 @@ bool DIDependencyAnalysisPass::runOnFunction(Function &F) {
   std::deque<DFLoop *> LQ;
   for (auto *DFN : DFF->getRegions())
     addLoopIntoQueue(DFN, LQ);
+  Profile.addCounter("loops", LQ.size());
+  Profile.addCounter("di-alias-nodes", DIAT.size());
+  Profile.addCounter("di-memories", DIAT.memory_size());
   for (auto *DFL : LQ) {
     auto L = DFL->getLoop();
     /// TODO (kaniandr@gmail.com): use other identifier because LLVM identifier
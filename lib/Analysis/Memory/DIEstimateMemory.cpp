@@ -30,6 +30,7 @@
 #include "tsar/Analysis/Memory/EstimateMemory.h"
 #include "tsar/Analysis/Memory/Utils.h"
 #include "tsar/Support/MetadataUtils.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Support/Utils.h"
 #include "tsar/Unparse/Utils.h"
 #include <bcl/IteratorDataAdaptor.h>
@@ -2388,6 +2389,7 @@ ImmutablePass * llvm::createDIMemoryEnvironmentStorage() {
 }
 
 bool DIEstimateMemoryPass::runOnFunction(Function &F) {
+  PassProfileRegion Profile(*this, &F);
   auto &AT = getAnalysis<EstimateMemoryPass>().getAliasTree();
   auto &EnvWrapper = getAnalysis<DIMemoryEnvironmentWrapper>();
   mDIAliasTree = nullptr;
@@ -2430,6 +2432,8 @@ bool DIEstimateMemoryPass::runOnFunction(Function &F) {
   auto MD = MDNode::get(F.getContext(), MemoryNodes);
   F.setMetadata(AliasTreeMDKind, MD);
   mDIAliasTree = Env.reset(F, std::move(NewDIAT));
+  Profile.addCounter("di-alias-nodes", mDIAliasTree->size());
+  Profile.addCounter("di-memories", mDIAliasTree->memory_size());
   return false;
 }
 
@@ -141,6 +141,7 @@ public:
     auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>();
     PM.add(createGlobalOptionsImmutableWrapper(&GO.getOptions()));
     PM.add(createGlobalDefinedMemoryStorage());
+    PM.add(createDefUseSummaryCacheStorage());
     PM.add(createGlobalLiveMemoryStorage());
     PM.add(createDIMemoryTraitPoolStorage());
     PM.add(createDIArrayAccessStorage());
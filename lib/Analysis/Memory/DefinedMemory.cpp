@@ -27,10 +27,13 @@
 #include "tsar/Analysis/Memory/EstimateMemory.h"
 #include "tsar/Analysis/Memory/MemoryAccessUtils.h"
 #include "tsar/Analysis/Memory/Utils.h"
+#include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/Utils.h"
 #include "tsar/Support/IRUtils.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Unparse/Utils.h"
 #include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/Statistic.h>
 #include <llvm/Analysis/AliasAnalysis.h>
 #include <llvm/Analysis/AliasSetTracker.h>
 #include <llvm/Analysis/LoopInfo.h>
@@ -41,6 +44,7 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/InstIterator.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Debug.h>
 #include <functional>
 
@@ -50,6 +54,49 @@ using namespace tsar;
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "def-mem"
 
+STATISTIC(NumCachedDefUse, "Number of reused def-use sets of basic blocks");
+
+static cl::opt<bool> DisableDefUseCache("disable-def-use-cache", cl::Hidden,
+  cl::desc("Do not reuse def-use sets of basic blocks between analysis steps"));
+
+namespace {
+class DefUseSummaryCacheStorage :
+  public ImmutablePass, private bcl::Uncopyable {
+public:
+  static char ID;
+
+  DefUseSummaryCacheStorage() : ImmutablePass(ID) {
+    initializeDefUseSummaryCacheStoragePass(*PassRegistry::getPassRegistry());
+  }
+
+  void initializePass() override {
+    getAnalysis<DefUseSummaryCacheWrapper>().set(mCache);
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DefUseSummaryCacheWrapper>();
+  }
+
+private:
+  DefUseSummaryCache mCache;
+};
+}
+
+char DefUseSummaryCacheStorage::ID = 0;
+INITIALIZE_PASS_BEGIN(DefUseSummaryCacheStorage, "def-mem-cache-is",
+  "Def-Use Summary Cache (Immutable Storage)", true, true)
+INITIALIZE_PASS_DEPENDENCY(DefUseSummaryCacheWrapper)
+INITIALIZE_PASS_END(DefUseSummaryCacheStorage, "def-mem-cache-is",
+  "Def-Use Summary Cache (Immutable Storage)", true, true)
+
+template<> char DefUseSummaryCacheWrapper::ID = 0;
+INITIALIZE_PASS(DefUseSummaryCacheWrapper, "def-mem-cache-iw",
+  "Def-Use Summary Cache (Immutable Wrapper)", true, true)
+
+ImmutablePass * llvm::createDefUseSummaryCacheStorage() {
+  return new DefUseSummaryCacheStorage();
+}
+
 char DefinedMemoryPass::ID = 0;
 INITIALIZE_PASS_BEGIN(DefinedMemoryPass, "def-mem",
   "Defined Memory Region Analysis", false, true)
@@ -58,10 +105,13 @@ INITIALIZE_PASS_BEGIN(DefinedMemoryPass, "def-mem",
   INITIALIZE_PASS_DEPENDENCY(EstimateMemoryPass)
   INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
   INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryWrapper)
+  INITIALIZE_PASS_DEPENDENCY(DefUseSummaryCacheWrapper)
+  INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
 INITIALIZE_PASS_END(DefinedMemoryPass, "def-mem",
   "Defined Memory Region Analysis", false, true)
 
 bool llvm::DefinedMemoryPass::runOnFunction(Function & F) {
+  PassProfileRegion Profile(*this, &F);
   auto &RegionInfo = getAnalysis<DFRegionInfoPass>().getRegionInfo();
   auto &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(F);
   auto &AliasTree = getAnalysis<EstimateMemoryPass>().getAliasTree();
@@ -69,13 +119,35 @@ bool llvm::DefinedMemoryPass::runOnFunction(Function & F) {
   LLVM_DEBUG(DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree());
   auto *DFF = cast<DFFunction>(RegionInfo.getTopLevelRegion());
   auto &GDM = getAnalysis<GlobalDefinedMemoryWrapper>();
+  auto &DUCache = getAnalysis<DefUseSummaryCacheWrapper>();
+  auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
+  DataFlowStatistics DFStats;
+  bool CollectStats = isDataFlowStatisticsRequested(Profile);
+  auto solve = [DFF, &GO, &DUCache, &DFStats, CollectStats](
+      ReachDFFwk &ReachDefFwk) {
+    if (DUCache)
+      ReachDefFwk.setSummaryCache(&DUCache.get());
+    if (CollectStats)
+      ReachDefFwk.setStatistics(&DFStats);
+    if (GO.NoLocationNumbering)
+      ReachDefFwk.disableLocationNumbering();
+    ReachDefFwk.setWorklistForced(GO.DataFlowWorklist);
+    if (GO.SparseReachDefinitions)
+      solveReachDefinitionsSparsely(&ReachDefFwk, DFF);
+    else
+      solveDataFlowUpward(&ReachDefFwk, DFF);
+  };
   if (GDM) {
     ReachDFFwk ReachDefFwk(AliasTree, TLI, DT, mDefInfo, *GDM);
-    solveDataFlowUpward(&ReachDefFwk, DFF);
+    solve(ReachDefFwk);
   } else {
     ReachDFFwk ReachDefFwk(AliasTree, TLI, DT, mDefInfo);
-    solveDataFlowUpward(&ReachDefFwk, DFF);
+    solve(ReachDefFwk);
   }
+  if (CollectStats)
+    reportDataFlowStatistics(DFStats, Profile);
+  Profile.addCounter("alias-nodes", AliasTree.size());
+  Profile.addCounter("df-nodes", mDefInfo.size());
   return false;
 }
 
@@ -85,6 +157,8 @@ void DefinedMemoryPass::getAnalysisUsage(AnalysisUsage & AU) const {
   AU.addRequired<EstimateMemoryPass>();
   AU.addRequired<TargetLibraryInfoWrapperPass>();
   AU.addRequired<GlobalDefinedMemoryWrapper>();
+  AU.addRequired<DefUseSummaryCacheWrapper>();
+  AU.addRequired<GlobalOptionsImmutableWrapper>();
   AU.setPreservesAll();
 }
 
@@ -326,6 +400,156 @@ void initializeTransferEndLog(const DefinitionInfo &Out, bool HasChanges,
 
 }
 #endif
+
+/// Returns a structural hash of an alias node which takes into account
+/// locations in the node only.
+hash_code hashAliasNode(const AliasNode &AN) {
+  auto Hash = hash_value(static_cast<unsigned>(AN.getKind()));
+  if (auto *EN = dyn_cast<AliasEstimateNode>(&AN)) {
+    for (auto &EM : *EN) {
+      Hash = hash_combine(Hash, EM.getSize().toRaw(),
+        DenseMapInfo<AAMDNodes>::getHashValue(EM.getAAInfo()));
+      for (auto *Ptr : EM)
+        Hash = hash_combine(Hash, Ptr, Ptr->getValueID(), Ptr->getType());
+    }
+  } else if (auto *UN = dyn_cast<AliasUnknownNode>(&AN)) {
+    // Order of instructions in the set depends on the order of insertion,
+    // so hashes of instructions are accumulated in order-independent way.
+    size_t UnknownHash = 0;
+    for (auto *I : *UN)
+      UnknownHash += hash_combine(I, I->getOpcode());
+    Hash = hash_combine(Hash, UnknownHash);
+  }
+  return Hash;
+}
+
+/// Returns a hash of a value which is used as an operand of an instruction.
+///
+/// A value may be deleted and a new one may be allocated at the same address,
+/// so the kind and the type of the value are also taken into account.
+hash_code hashOperand(const Value *V) {
+  return hash_combine(V, V->getValueID(), V->getType());
+}
+
+/// Returns a hash of an instruction which takes into account its operands,
+/// type and all flags which may influence memory accesses.
+hash_code hashInstruction(const Instruction &I) {
+  auto Hash = hash_combine(hashOperand(&I), I.getOpcode(),
+    I.getRawSubclassOptionalData());
+  for (auto *Op : I.operand_values())
+    Hash = hash_combine(Hash, hashOperand(Op));
+  if (auto *LI = dyn_cast<LoadInst>(&I)) {
+    Hash = hash_combine(Hash, LI->isVolatile(), LI->getAlignment(),
+      static_cast<unsigned>(LI->getOrdering()), LI->getSyncScopeID());
+  } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+    Hash = hash_combine(Hash, SI->isVolatile(), SI->getAlignment(),
+      static_cast<unsigned>(SI->getOrdering()), SI->getSyncScopeID());
+  } else if (auto *RMW = dyn_cast<AtomicRMWInst>(&I)) {
+    Hash = hash_combine(Hash, RMW->isVolatile(),
+      static_cast<unsigned>(RMW->getOperation()),
+      static_cast<unsigned>(RMW->getOrdering()), RMW->getSyncScopeID());
+  } else if (auto *CmpXchg = dyn_cast<AtomicCmpXchgInst>(&I)) {
+    Hash = hash_combine(Hash, CmpXchg->isVolatile(), CmpXchg->isWeak(),
+      static_cast<unsigned>(CmpXchg->getSuccessOrdering()),
+      static_cast<unsigned>(CmpXchg->getFailureOrdering()),
+      CmpXchg->getSyncScopeID());
+  } else if (auto *AI = dyn_cast<AllocaInst>(&I)) {
+    Hash = hash_combine(Hash, AI->getAllocatedType(), AI->getAlignment());
+  } else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+    Hash = hash_combine(Hash, GEP->getSourceElementType());
+  } else if (auto *Cmp = dyn_cast<CmpInst>(&I)) {
+    Hash = hash_combine(Hash, static_cast<unsigned>(Cmp->getPredicate()));
+  } else if (auto *Call = dyn_cast<CallBase>(&I)) {
+    // Attributes of a call and of a callee (for example, 'readonly') determine
+    // whether memory is accessed.
+    Hash = hash_combine(Hash, Call->getAttributes().getRawPointer(),
+      Call->getFunctionType());
+    if (auto *F = dyn_cast<Function>(
+          Call->getCalledOperand()->stripPointerCasts()))
+      Hash = hash_combine(Hash, F->getAttributes().getRawPointer(),
+        static_cast<unsigned>(F->getIntrinsicID()));
+  }
+  return Hash;
+}
+
+/// \brief Returns a structural hash of a specified basic block which
+/// determines its def-use set.
+///
+/// The hash takes into account instructions (including their types and flags)
+/// and their operands as well as accessed memory locations and alias nodes
+/// which may alias these locations. The second value is `true` if the def-use
+/// set depends on results of interprocedural analysis.
+std::pair<hash_code, bool> hashDefUseSummary(BasicBlock &BB,
+    ReachDFFwk &DFF) {
+  auto &AT = DFF.getAliasTree();
+  auto *InterDUInfo = DFF.getInterprocDefUseInfo();
+  bool UseInterproc = false;
+  auto Hash = hash_value(&BB);
+  for (Instruction &I : BB) {
+    Hash = hash_combine(Hash, hashInstruction(I));
+    if (auto II = llvm::dyn_cast<IntrinsicInst>(&I))
+      if (isMemoryMarkerIntrinsic(II->getIntrinsicID()) ||
+          isDbgInfoIntrinsic(II->getIntrinsicID()))
+        continue;
+    if (auto *Call = dyn_cast<CallBase>(&I)) {
+      auto F = llvm::dyn_cast<Function>(
+        Call->getCalledOperand()->stripPointerCasts());
+      if (F && InterDUInfo) {
+        UseInterproc = true;
+        // Results of interprocedural analysis are only added until they are
+        // cleared and the cache is invalidated at the same time
+        // (see DefUseSummaryCache::startStage()). So, it is sufficient to
+        // check whether results for a callee are available.
+        Hash = hash_combine(Hash, InterDUInfo->count(F) != 0);
+      }
+    }
+    if (!I.mayReadOrWriteMemory())
+      continue;
+    for_each_memory(I, DFF.getTLI(),
+      [&AT, &DFF, &Hash](Instruction &, MemoryLocation &&Loc,
+          unsigned Idx, AccessInfo R, AccessInfo W) {
+        auto *EM = AT.find(Loc);
+        assert(EM && "Estimate memory location must not be null!");
+        Hash = hash_combine(Hash, hashOperand(Loc.Ptr), Loc.Size.toRaw(),
+          DenseMapInfo<AAMDNodes>::getHashValue(Loc.AATags), Idx,
+          static_cast<unsigned>(R), static_cast<unsigned>(W),
+          DFF.getAliasHash(EM->getAliasNode(AT)));
+      },
+      [&AT, &DFF, &Hash](Instruction &I, AccessInfo R, AccessInfo W) {
+        auto *AN = AT.findUnknown(I);
+        Hash = hash_combine(Hash, &I,
+          static_cast<unsigned>(R), static_cast<unsigned>(W),
+          AN ? DFF.getAliasHash(AN) : hash_code(0));
+      });
+  }
+  return std::make_pair(Hash, UseInterproc);
+}
+}
+
+hash_code ReachDFFwk::getAliasHash(AliasNode *AN) {
+  assert(AN && "Alias node must not be null!");
+  return hash_combine(getAncestorHash(AN), getSubtreeHash(AN));
+}
+
+hash_code ReachDFFwk::getAncestorHash(AliasNode *AN) {
+  auto I = mAncestorHashes.find(AN);
+  if (I != mAncestorHashes.end())
+    return I->second;
+  auto *Parent = AN->getParent(*mAliasTree);
+  auto Hash = Parent ?
+    hash_combine(hashAliasNode(*Parent), getAncestorHash(Parent)) :
+    hash_code(0);
+  return mAncestorHashes[AN] = Hash;
+}
+
+hash_code ReachDFFwk::getSubtreeHash(AliasNode *AN) {
+  auto I = mSubtreeHashes.find(AN);
+  if (I != mSubtreeHashes.end())
+    return I->second;
+  auto Hash = hashAliasNode(*AN);
+  for (auto &Child : make_range(AN->child_begin(), AN->child_end()))
+    Hash = hash_combine(Hash, getSubtreeHash(&Child));
+  return mSubtreeHashes[AN] = Hash;
 }
 
 void DataFlowTraits<ReachDFFwk*>::initialize(
@@ -335,8 +559,7 @@ void DataFlowTraits<ReachDFFwk*>::initialize(
   if (llvm::isa<DFRegion>(N))
     return;
   auto &AT = DFF->getAliasTree();
-  auto Pair = DFF->getDefInfo().insert(std::make_pair(N, std::make_tuple(
-    std::make_unique<DefUseSet>(), std::make_unique<ReachSet>())));
+  auto Pair = DFF->getDefInfo().insertNode(N);
   auto *InterDUInfo = DFF->getInterprocDefUseInfo();
   auto &TLI = DFF->getTLI();
   // DefUseSet will be calculated here for nodes different to regions.
@@ -349,6 +572,18 @@ void DataFlowTraits<ReachDFFwk*>::initialize(
   BasicBlock *BB = DFB->getBlock();
   Function *F = BB->getParent();
   assert(BB && "Basic block must not be null!");
+  auto *Cache = DisableDefUseCache ? nullptr : DFF->getSummaryCache();
+  hash_code Hash;
+  bool UseInterproc = false;
+  if (Cache) {
+    std::tie(Hash, UseInterproc) = hashDefUseSummary(*BB, *DFF);
+    if (auto *Summary = Cache->lookup(BB, Hash)) {
+      *DU = *Summary;
+      ++NumCachedDefUse;
+      LLVM_DEBUG(intializeDefUseSetLog(*N, *DU, DFF->getDomTree()));
+      return;
+    }
+  }
   for (Instruction &I : BB->getInstList()) {
     // TODO (kaniandr@gmail.com): LLVM analysis says that memory marker
     // intrinsics may access memory, so we exclude these intrinsics from
@@ -519,6 +754,8 @@ void DataFlowTraits<ReachDFFwk*>::initialize(
       }
     );
   }
+  if (Cache)
+    Cache->insert(BB, Hash, *DU, UseInterproc);
   LLVM_DEBUG(intializeDefUseSetLog(*N, *DU, DFF->getDomTree()));
 }
 
@@ -534,6 +771,9 @@ bool DataFlowTraits<ReachDFFwk*>::transferFunction(
     I->get<ReachSet>() && I->get<DefUseSet>() &&
     "Data-flow value must be specified!");
   auto &RS = I->get<ReachSet>();
+  // Equal values are shared between nodes, so they are compared by a pointer.
+  V.MustReach.uniquify();
+  V.MayReach.uniquify();
   RS->setIn(std::move(V)); // Do not use V below to avoid undefined behavior.
   if (llvm::isa<DFExit>(N)) {
     if (RS->getOut().MustReach != RS->getIn().MustReach ||
@@ -548,10 +788,10 @@ bool DataFlowTraits<ReachDFFwk*>::transferFunction(
   auto &DU = I->get<DefUseSet>();
   assert(DU && "Value of def-use attribute must not be null!");
   DefinitionInfo newOut;
-  newOut.MustReach = LocationDFValue::emptyValue();
+  newOut.MustReach = LocationDFValue::emptyValue(DFF->getLocationNumbering());
   newOut.MustReach.insert(DU->getDefs().begin(), DU->getDefs().end());
   newOut.MustReach.merge(RS->getIn().MustReach);
-  newOut.MayReach = LocationDFValue::emptyValue();
+  newOut.MayReach = LocationDFValue::emptyValue(DFF->getLocationNumbering());
   // newOut.MayReach must contain both must and may defined locations.
   // Let us consider an example:
   // for(...) {
@@ -567,6 +807,8 @@ bool DataFlowTraits<ReachDFFwk*>::transferFunction(
   newOut.MayReach.insert(DU->getDefs().begin(), DU->getDefs().end());
   newOut.MayReach.insert(DU->getMayDefs().begin(), DU->getMayDefs().end());
   newOut.MayReach.merge(RS->getIn().MayReach);
+  newOut.MustReach.uniquify();
+  newOut.MayReach.uniquify();
   if (RS->getOut().MustReach != newOut.MustReach ||
     RS->getOut().MayReach != newOut.MayReach) {
     RS->setOut(std::move(newOut));
@@ -582,8 +824,7 @@ void ReachDFFwk::collapse(DFRegion *R) {
   typedef RegionDFTraits<ReachDFFwk *> RT;
   auto &AT = getAliasTree();
   auto &AA = AT.getAliasAnalysis();
-  auto Pair = getDefInfo().insert(std::make_pair(R, std::make_tuple(
-    std::make_unique<DefUseSet>(), std::make_unique<ReachSet>())));
+  auto Pair = getDefInfo().insertNode(R);
   auto &DefUse = Pair.first->get<DefUseSet>();
   assert(DefUse && "Value of def-use attribute must not be null!");
   // ExitingDefs.MustReach is a set of must define locations (Defs) for the
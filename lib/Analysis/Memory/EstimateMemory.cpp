@@ -25,6 +25,7 @@
 #include "tsar/Analysis/Memory/EstimateMemory.h"
 #include "tsar/Analysis/Memory/MemoryAccessUtils.h"
 #include "tsar/Analysis/Memory/MemorySetInfo.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Unparse/Utils.h"
 #include <llvm/ADT/Statistic.h>
 #include <llvm/ADT/PointerUnion.h>
@@ -36,7 +37,9 @@
 #include <llvm/IR/GetElementPtrTypeIterator.h>
 #include <llvm/IR/Operator.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
+#include <tuple>
 
 using namespace tsar;
 using namespace llvm;
@@ -50,6 +53,18 @@ STATISTIC(NumUnknownNode, "Number of unknown nodes created");
 STATISTIC(NumMergedNode, "Number of alias nodes merged in");
 STATISTIC(NumEstimateMemory, "Number of estimate memory created");
 STATISTIC(NumUnknownMemory, "Number of unknown memory created");
+STATISTIC(NumSkippedAliasQuery,
+  "Number of alias nodes skipped due to distinct underlying objects");
+STATISTIC(NumAliasCacheHit, "Number of alias queries found in the cache");
+STATISTIC(NumAliasCacheMiss, "Number of alias queries missed in the cache");
+STATISTIC(NumSearchCacheHit, "Number of searches found in the cache");
+STATISTIC(NumSearchCacheMiss, "Number of searches missed in the cache");
+STATISTIC(NumRedundantLocation,
+  "Number of skipped insertions which can not change alias tree");
+
+static cl::opt<unsigned> AliasCacheLimit("alias-cache-limit", cl::Hidden,
+  cl::init(1 << 18),
+  cl::desc("Maximum number of cached alias queries (0 - unlimited)"));
 
 static inline void clarifyUnknownSize(const DataLayout &DL,
     MemoryLocation &Loc, const DominatorTree *DT = nullptr) {
@@ -75,6 +90,31 @@ static inline void clarifyUnknownSize(const DataLayout &DL,
   });
 }
 
+/// Returns an identified object (see llvm::isIdentifiedObject()) which is
+/// accessed through a specified pointer or nullptr.
+///
+/// Lookup depth is the same as in BasicAA, so an alias analysis always proves
+/// that pointers to distinct identified objects do not alias.
+static inline const Value * getIdentifiedObject(const DataLayout &DL,
+    const Value *Ptr) {
+  auto *Object = GetUnderlyingObject(Ptr, DL);
+  return isIdentifiedObject(Object) ? Object : nullptr;
+}
+
+/// Returns an identified object which is accessed through all ambiguous
+/// pointers of a specified location or nullptr.
+static const Value * getIdentifiedObject(const DataLayout &DL,
+    const EstimateMemory &EM) {
+  const Value *Object = nullptr;
+  for (auto *Ptr : EM) {
+    auto *PtrObject = getIdentifiedObject(DL, Ptr);
+    if (!PtrObject || Object && Object != PtrObject)
+      return nullptr;
+    Object = PtrObject;
+  }
+  return Object;
+}
+
 namespace tsar {
 Value * stripPointer(const DataLayout &DL, Value *Ptr) {
   assert(Ptr && "Pointer to memory location must not be null!");
@@ -244,10 +284,13 @@ bool isSameBase(const DataLayout &DL,
   return false;
 }
 
-AliasDescriptor aliasRelation(AAResults &AA, const DataLayout &DL,
+/// Implementation of aliasRelation(), `Alias` is a functor which performs
+/// alias queries.
+template<class AliasFn>
+static AliasDescriptor aliasRelationImp(AliasFn &&Alias, const DataLayout &DL,
     const MemoryLocation &LHS, const MemoryLocation &RHS) {
   AliasDescriptor Dptr;
-  auto AR = AA.alias(
+  auto AR = Alias(
     isAAInfoCorrupted(LHS.AATags) ? LHS.getWithoutAATags() : LHS,
     isAAInfoCorrupted(RHS.AATags) ? RHS.getWithoutAATags() : RHS);
   switch (AR) {
@@ -266,9 +309,9 @@ AliasDescriptor aliasRelation(AAResults &AA, const DataLayout &DL,
       auto BaseRHS = GetPointerBaseWithConstantOffset(RHS.Ptr, OffsetRHS, DL);
       if (OffsetLHS == 0 && OffsetRHS == 0)
         break;
-      auto BaseAlias = AA.alias(
-        BaseLHS, LocationSize::unknown(),
-        BaseRHS, LocationSize::unknown());
+      auto BaseAlias = Alias(
+        MemoryLocation(BaseLHS, LocationSize::unknown()),
+        MemoryLocation(BaseRHS, LocationSize::unknown()));
       // It is possible to precisely compare two partially overlapped
       // locations in case of the same base pointer only.
       if (BaseAlias != MustAlias)
@@ -311,16 +354,19 @@ AliasDescriptor aliasRelation(AAResults &AA, const DataLayout &DL,
   return Dptr;
 }
 
-AliasDescriptor aliasRelation(AAResults &AA, const DataLayout &DL,
+/// Implementation of aliasRelation(), `Alias` is a functor which performs
+/// alias queries.
+template<class AliasFn>
+static AliasDescriptor aliasRelationImp(AliasFn &&Alias, const DataLayout &DL,
     const EstimateMemory &LHS, const EstimateMemory &RHS) {
-  auto MergedAD = aliasRelation(AA, DL,
+  auto MergedAD = aliasRelationImp(Alias, DL,
     MemoryLocation(LHS.front(), LHS.getSize(), LHS.getAAInfo()),
     MemoryLocation(RHS.front(), RHS.getSize(), RHS.getAAInfo()));
   if (MergedAD.is<trait::MayAlias>())
     return MergedAD;
   for (auto PtrLHS: LHS)
     for (auto PtrRHS : RHS) {
-      auto AD = aliasRelation(AA, DL,
+      auto AD = aliasRelationImp(Alias, DL,
         MemoryLocation(PtrLHS, LHS.getSize(), LHS.getAAInfo()),
         MemoryLocation(PtrRHS, RHS.getSize(), RHS.getAAInfo()));
       MergedAD = mergeAliasRelation(MergedAD, AD);
@@ -330,6 +376,38 @@ AliasDescriptor aliasRelation(AAResults &AA, const DataLayout &DL,
   return MergedAD;
 }
 
+AliasDescriptor aliasRelation(AAResults &AA, const DataLayout &DL,
+    const MemoryLocation &LHS, const MemoryLocation &RHS) {
+  return aliasRelationImp(
+    [&AA](const MemoryLocation &First, const MemoryLocation &Second) {
+      return AA.alias(First, Second);
+    }, DL, LHS, RHS);
+}
+
+AliasDescriptor aliasRelation(AAResults &AA, const DataLayout &DL,
+    const EstimateMemory &LHS, const EstimateMemory &RHS) {
+  return aliasRelationImp(
+    [&AA](const MemoryLocation &First, const MemoryLocation &Second) {
+      return AA.alias(First, Second);
+    }, DL, LHS, RHS);
+}
+
+AliasDescriptor aliasRelation(const AliasTree &G, const DataLayout &DL,
+    const MemoryLocation &LHS, const MemoryLocation &RHS) {
+  return aliasRelationImp(
+    [&G](const MemoryLocation &First, const MemoryLocation &Second) {
+      return G.alias(First, Second);
+    }, DL, LHS, RHS);
+}
+
+AliasDescriptor aliasRelation(const AliasTree &G, const DataLayout &DL,
+    const EstimateMemory &LHS, const EstimateMemory &RHS) {
+  return aliasRelationImp(
+    [&G](const MemoryLocation &First, const MemoryLocation &Second) {
+      return G.alias(First, Second);
+    }, DL, LHS, RHS);
+}
+
 const EstimateMemory * ancestor(
     const EstimateMemory *LHS, const EstimateMemory *RHS) noexcept {
   for (auto EM = LHS; EM; EM = EM->getParent())
@@ -497,11 +575,61 @@ void mergeChainAfterLog(EstimateMemory *EM, const DominatorTree &DT) {
 #endif
 }
 
+constexpr AliasTreeLayout::index_type AliasTreeLayout::InvalidIndex;
+
+AliasTreeLayout::AliasTreeLayout(const AliasTree &G) {
+  struct StackEntry {
+    const AliasNode *Node;
+    index_type Idx;
+    AliasNode::const_child_iterator ChildItr;
+    index_type PrevChild;
+  };
+  auto addNode = [this](const AliasNode &N, index_type Parent) {
+    assert(mNodes.size() < InvalidIndex && "Too many nodes in alias tree!");
+    index_type Idx = mNodes.size();
+    mNodes.push_back(&N);
+    mParents.push_back(Parent);
+    mFirstChildren.push_back(InvalidIndex);
+    mNextSiblings.push_back(InvalidIndex);
+    return Idx;
+  };
+  mNodes.reserve(G.size());
+  mPostorder.reserve(G.size());
+  auto *Root = G.getTopLevelNode();
+  SmallVector<StackEntry, 16> Stack;
+  Stack.push_back({Root, addNode(*Root, InvalidIndex), Root->child_begin(),
+                   InvalidIndex});
+  while (!Stack.empty()) {
+    auto &Entry = Stack.back();
+    if (Entry.ChildItr == Entry.Node->child_end()) {
+      mPostorder.push_back(Entry.Idx);
+      Stack.pop_back();
+      continue;
+    }
+    auto &Child = *Entry.ChildItr++;
+    auto ChildIdx = addNode(Child, Entry.Idx);
+    if (Entry.PrevChild == InvalidIndex)
+      mFirstChildren[Entry.Idx] = ChildIdx;
+    else
+      mNextSiblings[Entry.PrevChild] = ChildIdx;
+    Entry.PrevChild = ChildIdx;
+    Stack.push_back({&Child, ChildIdx, Child.child_begin(), InvalidIndex});
+  }
+}
+
 void AliasTree::add(const MemoryLocation &Loc) {
   assert(Loc.Ptr && "Pointer to memory location must not be null!");
   assert(!isa<UndefValue>(Loc.Ptr) && "Pointer to memory location must be valid!");
   LLVM_DEBUG(dbgs() << "[ALIAS TREE]: add memory location\n");
-  mSearchCache.clear();
+  auto RedundantItr = mRedundantLocations.find(Loc);
+  if (RedundantItr != mRedundantLocations.end() &&
+      RedundantItr->second.Generation ==
+        getBaseGeneration(RedundantItr->second.StrippedPtr)) {
+    LLVM_DEBUG(dbgs() << "[ALIAS TREE]: skip redundant insertion\n");
+    ++NumRedundantLocation;
+    return;
+  }
+  mLayout.reset();
   using CT = bcl::ChainTraits<EstimateMemory, Hierarchy>;
   MemoryLocation Base(Loc);
   clarifyUnknownSize(*mDL, Base, mDT);
@@ -509,6 +637,15 @@ void AliasTree::add(const MemoryLocation &Loc) {
   do {
     LLVM_DEBUG(evaluateMemoryLevelLog(Base, getDomTree()));
     stripToBase(*mDL, Base);
+    // Insertion of the first memory level depends on a list of bases for
+    // a stripped pointer only. So, if the list is not changed after insertion
+    // of this level, repeated insertions of `Loc` can be skipped until the
+    // list changes.
+    RedundantInsertion Redundant;
+    if (!PrevChainEnd) {
+      Redundant.StrippedPtr = stripPointer(*mDL, const_cast<Value *>(Base.Ptr));
+      Redundant.Generation = getBaseGeneration(Redundant.StrippedPtr);
+    }
     EstimateMemory *EM;
     bool IsNew, AddAmbiguous;
     std::tie(EM, IsNew, AddAmbiguous) = insert(Base);
@@ -519,6 +656,11 @@ void AliasTree::add(const MemoryLocation &Loc) {
       assert((!PrevChainEnd->getParent() || PrevChainEnd->getParent() == EM) &&
         "Inconsistent parent of a node in estimate memory tree!");
       LLVM_DEBUG(mergeChainBeforeLog(EM, PrevChainEnd, getDomTree()));
+      // Parent of the end of a chain is checked in insert(), so the list of
+      // bases which contains this chain is updated.
+      if (PrevChainEnd->getParent() != EM)
+        ++mBaseGenerations[stripPointer(
+          *mDL, const_cast<Value *>(PrevChainEnd->front()))];
       CT::mergeNext(EM, PrevChainEnd);
       LLVM_DEBUG(mergeChainAfterLog(EM, getDomTree()));
     }
@@ -527,6 +669,9 @@ void AliasTree::add(const MemoryLocation &Loc) {
         LLVM_DEBUG(dbgs() << "[ALIAS TREE]: skip memory level processing\n");
         continue;
       }
+      if (!PrevChainEnd &&
+          Redundant.Generation == getBaseGeneration(Redundant.StrippedPtr))
+        mRedundantLocations[Loc] = Redundant;
       LLVM_DEBUG(dbgs() << "[ALIAS TREE]: end memory levels processing\n");
       return;
     }
@@ -538,6 +683,7 @@ void AliasTree::add(const MemoryLocation &Loc) {
       if (IsNew) {
         auto Node = addEmptyNode(*EM, *getTopLevelNode());
         EM->setAliasNode(*Node, *this);
+        Node->joinUnderlyingObject(getIdentifiedObject(*mDL, *EM), *this);
       }
       while (CT::getPrev(EM))
         EM = CT::getPrev(EM);
@@ -585,6 +731,7 @@ void AliasTree::add(const MemoryLocation &Loc) {
         CT::getNext(EM)->getAliasNode(*this) : getTopLevelNode();
       auto Node = addEmptyNode(*EM, *CurrNode);
       EM->setAliasNode(*Node, *this);
+      Node->joinUnderlyingObject(getIdentifiedObject(*mDL, *EM), *this);
     }
   } while (stripMemoryLevel(*mDL, Base));
   LLVM_DEBUG(dbgs() << "[ALIAS TREE]: end memory levels processing\n");
@@ -607,6 +754,7 @@ void tsar::AliasTree::addUnknown(llvm::Instruction *I) {
   if ((!isa<CallBase>(I) || isa<IntrinsicInst>(I)) &&
       !I->mayReadOrWriteMemory())
     return;
+  mLayout.reset();
   SmallVector<AliasNode *, 4> UnknownAliases, EstimateAliases;
   auto Children = make_range(
     getTopLevelNode()->child_begin(), getTopLevelNode()->child_end());
@@ -620,7 +768,6 @@ void tsar::AliasTree::addUnknown(llvm::Instruction *I) {
       else
         EstimateAliases.push_back(&Child);
   }
-  mSearchCache.clear();
   AliasUnknownNode *Node;
   if (!UnknownAliases.empty()) {
     auto AI = UnknownAliases.begin(), EI = UnknownAliases.end();
@@ -639,6 +786,7 @@ void tsar::AliasTree::addUnknown(llvm::Instruction *I) {
 }
 
 void AliasTree::removeNode(AliasNode *N) {
+  mLayout.reset();
   if (auto *Fwd = N->mForward) {
     Fwd->release(*this);
     N->mForward = nullptr;
@@ -676,11 +824,12 @@ AliasUnknownNode::slowMayAliasUnknownImp(
 }
 
 std::pair<bool, EstimateMemory *>
-AliasEstimateNode::slowMayAliasImp(const EstimateMemory &EM, AAResults &AA) {
+AliasEstimateNode::slowMayAliasImp(const EstimateMemory &EM,
+    const AliasTree &G) {
   for (auto &ThisEM : *this)
     for (auto *LHSPtr : ThisEM)
       for (auto *RHSPtr : EM) {
-        auto AR = AA.alias(
+        auto AR = G.alias(
           MemoryLocation(LHSPtr, ThisEM.getSize(), ThisEM.getAAInfo()),
           MemoryLocation(RHSPtr, EM.getSize(), EM.getAAInfo()));
         if (AR == NoAlias)
@@ -691,7 +840,9 @@ AliasEstimateNode::slowMayAliasImp(const EstimateMemory &EM, AAResults &AA) {
 }
 
 std::pair<bool, EstimateMemory *>
-AliasUnknownNode::slowMayAliasImp(const EstimateMemory &EM, AAResults &AA) {
+AliasUnknownNode::slowMayAliasImp(const EstimateMemory &EM,
+    const AliasTree &G) {
+  auto &AA = G.getAliasAnalysis();
   for (auto *UI : *this) {
     for (auto *Ptr : EM)
       if (AA.getModRefInfo(UI, MemoryLocation(Ptr, EM.getSize(), EM.getAAInfo()))
@@ -712,27 +863,35 @@ AliasEstimateNode * AliasTree::addEmptyNode(
     return Ptr.is<AliasNode *>() ? Ptr.get<AliasNode *>() :
       Ptr.get<EstimateMemory *>()->getAliasNode(*this);
   };
+  // Children bound to an identified object which differs from the object of
+  // NewEM do not alias NewEM, so do not ask alias analysis about them.
+  auto *Object = getIdentifiedObject(*mDL, NewEM);
+  SmallVector<AliasNode *, 8> Children, Grandchildren;
   for (;;) {
     // This condition is necessary due to alias node which contains full memory
     // should not be descendant of a node which contains part of this memory.
     if (ChildrenNodes.count(Current))
       return cast<AliasEstimateNode>(Current);
     Aliases.clear();
-    for (auto &Ch : make_range(Current->child_begin(), Current->child_end())) {
-      auto Result = Ch.slowMayAlias(NewEM, *mAA);
+    NumSkippedAliasQuery +=
+      Current->collectMayAliasChildren(Object, Children);
+    for (auto *Ch : Children) {
+      auto Result = Ch->slowMayAlias(NewEM, *this);
       if (Result.first) {
         if (Result.second)
           Aliases.push_back(Result.second);
         else
-          Aliases.push_back(&Ch);
+          Aliases.push_back(Ch);
       } else if (isa<AliasUnknownNode>(Ch)) {
         // If unknown node does not alias with a memory it does not mean
         // that its children nodes do not alias with this memory. The issue is
         // that unknown node may not cover its children nodes.
-        for (auto &N : make_range(Ch.child_begin(), Ch.child_end())) {
-          auto Result = N.slowMayAlias(NewEM, *mAA);
+        NumSkippedAliasQuery +=
+          Ch->collectMayAliasChildren(Object, Grandchildren);
+        for (auto *N : Grandchildren) {
+          auto Result = N->slowMayAlias(NewEM, *this);
           if (Result.first) {
-            Aliases.push_back(&Ch);
+            Aliases.push_back(Ch);
             break;
           }
         }
@@ -750,7 +909,7 @@ AliasEstimateNode * AliasTree::addEmptyNode(
       auto Node = EM->getAliasNode(*this);
       assert(Node && "Alias node for memory location must not be null!");
       auto AD = aliasRelation(
-        *mAA, *mDL, NewEM, AliasEstimateNode::iterator(EM), Node->end());
+        *this, *mDL, NewEM, AliasEstimateNode::iterator(EM), Node->end());
       if (AD.is<trait::CoverAlias>()) {
         auto *NewNode = make_node<AliasEstimateNode, llvm::Statistic, 2>(
           *Current, {&NumAliasNode, &NumEstimateNode});
@@ -768,7 +927,7 @@ AliasEstimateNode * AliasTree::addEmptyNode(
         auto EM = I->get<EstimateMemory *>();
         auto Node = EM->getAliasNode(*this);
         assert(Node && "Alias node for memory location must not be null!");
-        auto AD = aliasRelation(*mAA, *mDL, NewEM, Node->begin(), Node->end());
+        auto AD = aliasRelation(*this, *mDL, NewEM, Node->begin(), Node->end());
         if (AD.is<trait::CoverAlias>() ||
             (AD.is<trait::CoincideAlias>() && !AD.is<trait::ContainedAlias>()))
           continue;
@@ -817,7 +976,7 @@ AliasResult AliasTree::isSamePointer(
   auto LocAATags = sanitizeAAInfo(Loc.AATags);
   bool IsAmbiguous = false;
   for (auto *Ptr : EM) {
-    switch (mAA->alias(
+    switch (alias(
         MemoryLocation(Ptr, 1, EM.getAAInfo()),
         MemoryLocation(Loc.Ptr, 1, LocAATags))) {
       case MustAlias: return MustAlias;
@@ -827,6 +986,39 @@ AliasResult AliasTree::isSamePointer(
   return IsAmbiguous ? MayAlias : NoAlias;
 }
 
+AliasResult AliasTree::alias(
+    const MemoryLocation &LHS, const MemoryLocation &RHS) const {
+  if (!mUseAliasCache)
+    return mAA->alias(LHS, RHS);
+  // Alias relation is symmetric, so store a pair of locations in a canonical
+  // order to share results of alias(A, B) and alias(B, A) queries.
+  auto getKey = [](const MemoryLocation &Loc) {
+    return std::make_tuple(Loc.Ptr, Loc.Size.toRaw(), Loc.AATags.TBAA,
+      Loc.AATags.Scope, Loc.AATags.NoAlias);
+  };
+  auto Key = getKey(RHS) < getKey(LHS) ? std::make_pair(RHS, LHS) :
+    std::make_pair(LHS, RHS);
+  if (AliasCacheLimit > 0 && mAliasCache.size() >= AliasCacheLimit) {
+    // Do not cache new results if the cache is full.
+    auto I = mAliasCache.find(Key);
+    if (I != mAliasCache.end()) {
+      ++NumAliasCacheHit;
+      return I->second;
+    }
+    ++NumAliasCacheMiss;
+    return mAA->alias(LHS, RHS);
+  }
+  auto Info = mAliasCache.try_emplace(Key, MayAlias);
+  if (!Info.second) {
+    ++NumAliasCacheHit;
+    return Info.first->second;
+  }
+  ++NumAliasCacheMiss;
+  auto AR = mAA->alias(LHS, RHS);
+  Info.first->second = AR;
+  return AR;
+}
+
 const AliasUnknownNode * AliasTree::findUnknown(
     const llvm::Instruction &I) const {
   auto Children = make_range(
@@ -847,10 +1039,16 @@ const EstimateMemory * AliasTree::find(const llvm::MemoryLocation &Loc) const {
   MemoryLocation Base(Loc);
   clarifyUnknownSize(*mDL, Base, mDT);
   stripToBase(*mDL, Base);
-  auto SearchInfo = mSearchCache.try_emplace(Base, nullptr);
-  if (!SearchInfo.second)
-    return SearchInfo.first->second;
+  auto SearchInfo = mSearchCache.try_emplace(Base);
+  auto &Cached = SearchInfo.first->second;
+  if (!SearchInfo.second &&
+      Cached.Generation == getBaseGeneration(Cached.StrippedPtr)) {
+    ++NumSearchCacheHit;
+    return Cached.EM;
+  }
+  ++NumSearchCacheMiss;
   Value *StrippedPtr = stripPointer(*mDL, const_cast<Value *>(Base.Ptr));
+  Cached = SearchResult{nullptr, StrippedPtr, getBaseGeneration(StrippedPtr)};
   auto I = mBases.find(StrippedPtr);
   if (I == mBases.end())
     return nullptr;
@@ -873,7 +1071,7 @@ const EstimateMemory * AliasTree::find(const llvm::MemoryLocation &Loc) const {
       if (MemorySetInfo<MemoryLocation>::sizecmp(
             Base.Size, Chain->getSize()) > 0)
         continue;
-      SearchInfo.first->second = Chain;
+      Cached.EM = Chain;
       return Chain;
     } while (Prev = Chain, Chain = CT::getNext(Chain));
   }
@@ -920,9 +1118,18 @@ AliasTree::insert(const MemoryLocation &Base) {
       case MayAlias:
         AddAmbiguous = true;
         Chain->getAmbiguousList()->push_back(Base.Ptr);
+        ++mBaseGenerations[StrippedPtr];
         break;
       }
       using CT = bcl::ChainTraits<EstimateMemory, Hierarchy>;
+      if (AddAmbiguous) {
+        // The list of ambiguous pointers is shared between all locations in
+        // the chain, so update objects accessed by their alias nodes.
+        auto *Object = getIdentifiedObject(*mDL, Base.Ptr);
+        for (auto *EM = Chain; EM; EM = CT::getNext(EM))
+          if (EM->hasAliasNode())
+            EM->getAliasNode(*this)->joinUnderlyingObject(Object, *this);
+      }
       EstimateMemory *Prev = nullptr, *UpdateChain = nullptr;
       do {
         if (MemorySetInfo<MemoryLocation>::sizecmp(
@@ -967,10 +1174,14 @@ AliasTree::insert(const MemoryLocation &Base) {
         auto EM = new EstimateMemory(*Prev, Base.Size, Base.AATags);
         ++NumEstimateMemory;
         CT::spliceNext(EM, Prev);
+        ++mBaseGenerations[StrippedPtr];
         return std::make_tuple(EM, true, AddAmbiguous);
       }
       if (Base.Size == UpdateChain->getSize()) {
+        auto AATags = UpdateChain->getAAInfo();
         UpdateChain->updateAAInfo(Base.AATags);
+        if (AATags != UpdateChain->getAAInfo())
+          ++mBaseGenerations[StrippedPtr];
         return std::make_tuple(UpdateChain, false, AddAmbiguous);
       }
       assert(MemorySetInfo<MemoryLocation>::sizecmp(
@@ -980,6 +1191,7 @@ AliasTree::insert(const MemoryLocation &Base) {
       CT::splicePrev(EM, UpdateChain);
       if (ChainBegin == UpdateChain)
         ChainBegin = EM; // update start point of this chain in a base list
+      ++mBaseGenerations[StrippedPtr];
       return std::make_tuple(EM, true, AddAmbiguous);
     }
   } else {
@@ -989,6 +1201,7 @@ AliasTree::insert(const MemoryLocation &Base) {
   auto Chain = new EstimateMemory(Base, AmbiguousRef::make(mAmbiguousPool));
   ++NumEstimateMemory;
   BL->push_back(Chain);
+  ++mBaseGenerations[StrippedPtr];
   return std::make_tuple(Chain, true, false);
 }
 
@@ -1014,6 +1227,7 @@ FunctionPass * llvm::createEstimateMemoryPass() {
 
 bool EstimateMemoryPass::runOnFunction(Function &F) {
   releaseMemory();
+  PassProfileRegion Profile(*this, &F);
   auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
   auto &AA = getAnalysis<AAResultsWrapperPass>().getAAResults();
   auto &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(F);
@@ -1089,5 +1303,14 @@ bool EstimateMemoryPass::runOnFunction(Function &F) {
       }
     }
   }
+  if (Profile) {
+    std::size_t NumMemory = 0;
+    for (auto &N : *mAliasTree)
+      if (auto *EN = dyn_cast<AliasEstimateNode>(&N))
+        NumMemory += std::distance(EN->begin(), EN->end());
+    Profile.addCounter("alias-nodes", mAliasTree->size());
+    Profile.addCounter("estimate-memories", NumMemory);
+  }
+  mAliasTree->releaseAliasCache();
   return false;
 }
@@ -0,0 +1,482 @@
+//===- FunctionFingerprint.cpp - Function Fingerprint Analysis --*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass which computes a fingerprint for each function
+// in a module. A fingerprint is a hash of everything results of function-level
+// analysis depend on:
+// - LLVM IR of a function itself (including source-level debug information,
+//   metadata attachments, flags of instructions, attributes, layouts of used
+//   structures and properties and initializers of used globals),
+// - fingerprints of all callees (so, a change of a function invalidates
+//   results for all its transitive callers),
+// - live memory locations at function exit which are computed according to
+//   calls of this function (so, a change of a caller which influences results
+//   of analysis of a callee invalidates these results).
+// Numbering of metadata and attribute groups depends on the whole module,
+// so the textual representation of LLVM IR is not used to compute a hash.
+//
+// If incremental analysis is enabled the pass also loads results which are
+// available in a cache of analysis results and marks functions which results
+// have been loaded, so some expensive passes may skip these functions.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Analysis/Attributes.h"
+#include "tsar/Analysis/Memory/FunctionFingerprint.h"
+#include "tsar/Analysis/Memory/LiveMemory.h"
+#include "tsar/Analysis/Memory/Passes.h"
+#include "tsar/Support/AnalysisCache.h"
+#include "tsar/Support/GlobalOptions.h"
+#include <bcl/utility.h>
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Analysis/CallGraph.h>
+#include <llvm/InitializePasses.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/ModuleSlotTracker.h>
+#include <llvm/Pass.h>
+#include <llvm/Support/raw_sha1_ostream.h>
+#include <vector>
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "fingerprint"
+
+using namespace llvm;
+using namespace tsar;
+
+STATISTIC(NumCachedFunc, "Number of functions with cached analysis results");
+
+namespace {
+/// Writes a representation of a function which does not depend on
+/// numbering of metadata and attribute groups in a module.
+class FunctionWriter {
+public:
+  FunctionWriter(const Function &F, ModuleSlotTracker &MST, raw_ostream &OS)
+      : mF(F), mMST(MST), mOS(OS) {
+    for (auto &Arg : F.args())
+      mLocals.try_emplace(&Arg, mLocals.size());
+    for (auto &BB : F) {
+      mLocals.try_emplace(&BB, mLocals.size());
+      for (auto &I : BB)
+        mLocals.try_emplace(&I, mLocals.size());
+    }
+    F.getContext().getMDKindNames(mMDKindNames);
+  }
+
+  /// Writes a function body and its description.
+  void write() {
+    mOS << mF.getName() << '\0';
+    writeType(mF.getFunctionType());
+    mOS << ' ' << mF.getLinkage() << ' ' << mF.getCallingConv() << ' ';
+    writeAttributes(mF.getAttributes());
+    if (auto *SP = mF.getSubprogram())
+      mOS << SP->getName() << ':' << SP->getFilename() << ':' << SP->getLine();
+    mOS << '\0';
+    for (auto &BB : mF) {
+      mOS << "bb" << '\0';
+      for (auto &I : BB)
+        write(I);
+    }
+  }
+
+  /// Returns a representation of a memory location.
+  std::string toString(const MemoryLocationRange &Loc) {
+    std::string Str;
+    raw_string_ostream OS(Str);
+    FunctionWriter(*this, OS).write(Loc);
+    return OS.str();
+  }
+
+private:
+  FunctionWriter(const FunctionWriter &FW, raw_ostream &OS)
+      : mF(FW.mF), mMST(FW.mMST), mOS(OS), mLocals(FW.mLocals),
+        mMDKindNames(FW.mMDKindNames) {}
+
+  void write(const MemoryLocationRange &Loc) {
+    writeOperand(Loc.Ptr);
+    mOS << ',';
+    Loc.LowerBound.print(mOS);
+    mOS << ',';
+    Loc.UpperBound.print(mOS);
+  }
+
+  void write(const Instruction &I) {
+    mOS << I.getOpcodeName() << ' ';
+    writeType(I.getType());
+    if (auto *Cmp = dyn_cast<CmpInst>(&I)) {
+      mOS << ' ' << Cmp->getPredicate();
+    } else if (auto *AI = dyn_cast<AllocaInst>(&I)) {
+      mOS << ' ';
+      writeType(AI->getAllocatedType());
+      mOS << " align " << AI->getAlignment();
+    } else if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) {
+      mOS << ' ';
+      writeType(GEP->getSourceElementType());
+      if (GEP->isInBounds())
+        mOS << " inbounds";
+    } else if (auto *Call = dyn_cast<CallBase>(&I)) {
+      mOS << ' ';
+      writeType(Call->getFunctionType());
+      mOS << ' ' << Call->getCallingConv() << ' ';
+      if (auto *CI = dyn_cast<CallInst>(Call))
+        mOS << CI->getTailCallKind() << ' ';
+      writeAttributes(Call->getAttributes());
+    } else if (auto *LI = dyn_cast<LoadInst>(&I)) {
+      mOS << (LI->isVolatile() ? " volatile" : "") << " align "
+          << LI->getAlignment() << ' ' << toIRString(LI->getOrdering());
+    } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+      mOS << (SI->isVolatile() ? " volatile" : "") << " align "
+          << SI->getAlignment() << ' ' << toIRString(SI->getOrdering());
+    } else if (auto *RMW = dyn_cast<AtomicRMWInst>(&I)) {
+      mOS << ' ' << AtomicRMWInst::getOperationName(RMW->getOperation())
+          << (RMW->isVolatile() ? " volatile " : " ")
+          << toIRString(RMW->getOrdering());
+    } else if (auto *CmpXchg = dyn_cast<AtomicCmpXchgInst>(&I)) {
+      mOS << (CmpXchg->isVolatile() ? " volatile" : "")
+          << (CmpXchg->isWeak() ? " weak " : " ")
+          << toIRString(CmpXchg->getSuccessOrdering()) << ' '
+          << toIRString(CmpXchg->getFailureOrdering());
+    }
+    if (isa<OverflowingBinaryOperator>(I))
+      mOS << (I.hasNoUnsignedWrap() ? " nuw" : "")
+          << (I.hasNoSignedWrap() ? " nsw" : "");
+    if (isa<PossiblyExactOperator>(I) && I.isExact())
+      mOS << " exact";
+    if (isa<FPMathOperator>(I))
+      I.getFastMathFlags().print(mOS);
+    for (auto &Op : I.operands()) {
+      mOS << ' ';
+      writeOperand(Op);
+    }
+    if (auto &Loc = I.getDebugLoc())
+      mOS << " !" << Loc.getLine() << ':' << Loc.getCol();
+    // Metadata attachments (for example, !tbaa and !llvm.loop) may influence
+    // analysis, so all of them are written.
+    SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+    I.getAllMetadataOtherThanDebugLoc(MDs);
+    for (auto &MD : MDs) {
+      mOS << " !" << mMDKindNames[MD.first] << ' ';
+      writeMetadata(MD.second);
+    }
+    mOS << '\0';
+  }
+
+  /// Writes a type, bodies of named structures are written at the first use,
+  /// so a change of a structure layout changes the representation.
+  void writeType(Type *Ty) {
+    if (auto *STy = dyn_cast<StructType>(Ty)) {
+      if (STy->hasName()) {
+        mOS << '%' << STy->getName();
+        if (!mStructs.insert(STy).second)
+          return;
+      }
+      if (STy->isOpaque()) {
+        mOS << " opaque";
+        return;
+      }
+      mOS << (STy->isPacked() ? "<{" : "{");
+      for (auto *ElTy : STy->elements()) {
+        writeType(ElTy);
+        mOS << ',';
+      }
+      mOS << (STy->isPacked() ? "}>" : "}");
+    } else if (auto *PTy = dyn_cast<PointerType>(Ty)) {
+      writeType(PTy->getElementType());
+      if (auto AS = PTy->getAddressSpace())
+        mOS << " addrspace(" << AS << ')';
+      mOS << '*';
+    } else if (auto *ATy = dyn_cast<ArrayType>(Ty)) {
+      mOS << '[' << ATy->getNumElements() << " x ";
+      writeType(ATy->getElementType());
+      mOS << ']';
+    } else if (auto *FTy = dyn_cast<FunctionType>(Ty)) {
+      writeType(FTy->getReturnType());
+      mOS << '(';
+      for (auto *ParamTy : FTy->params()) {
+        writeType(ParamTy);
+        mOS << ',';
+      }
+      mOS << (FTy->isVarArg() ? "...)" : ")");
+    } else {
+      Ty->print(mOS);
+    }
+  }
+
+  /// Writes attributes of a function, its return value and parameters.
+  void writeAttributes(const AttributeList &AL) {
+    for (unsigned Idx = AL.index_begin(), IdxE = AL.index_end(); Idx != IdxE;
+         ++Idx)
+      if (AL.hasAttributes(Idx))
+        mOS << Idx << '=' << AL.getAsString(Idx, false) << ';';
+  }
+
+  /// Writes properties of a global value which may influence analysis.
+  void writeGlobal(const GlobalValue &GV) {
+    mOS << ' ' << GV.getLinkage() << ' ' << GV.getThreadLocalMode() << ' '
+        << GV.getAddressSpace();
+    if (auto *Var = dyn_cast<GlobalVariable>(&GV)) {
+      mOS << (Var->isConstant() ? " constant" : " global") << " align "
+          << Var->getAlignment();
+      if (Var->hasInitializer()) {
+        mOS << " = ";
+        writeOperand(Var->getInitializer());
+      }
+    }
+  }
+
+  void writeOperand(const Value *V) {
+    if (!V) {
+      mOS << "null";
+      return;
+    }
+    auto LocalItr = mLocals.find(V);
+    if (LocalItr != mLocals.end()) {
+      mOS << '%' << LocalItr->second;
+    } else if (auto *GV = dyn_cast<GlobalValue>(V)) {
+      mOS << '@' << GV->getName() << ':';
+      writeType(GV->getValueType());
+      if (mGlobals.insert(GV).second)
+        writeGlobal(*GV);
+    } else if (auto *MDV = dyn_cast<MetadataAsValue>(V)) {
+      writeMetadata(MDV->getMetadata());
+    } else if (isa<Constant>(V) || isa<InlineAsm>(V)) {
+      writeType(V->getType());
+      mOS << ' ';
+      V->printAsOperand(mOS, false, mMST);
+    } else {
+      mOS << '?';
+    }
+  }
+
+  /// Writes metadata, debug information is written partially to avoid
+  /// dependence on the whole compile unit.
+  void writeMetadata(const Metadata *MD) {
+    if (!MD) {
+      mOS << "null";
+    } else if (auto *Var = dyn_cast<DILocalVariable>(MD)) {
+      mOS << "!var " << Var->getName() << ':' << Var->getLine() << ':'
+          << Var->getArg() << ':';
+      writeMetadata(Var->getType());
+    } else if (auto *Expr = dyn_cast<DIExpression>(MD)) {
+      mOS << "!expr";
+      for (auto Op : Expr->getElements())
+        mOS << ' ' << Op;
+    } else if (auto *Loc = dyn_cast<DILocation>(MD)) {
+      mOS << "!loc " << Loc->getLine() << ':' << Loc->getColumn();
+    } else if (auto *DITy = dyn_cast<DIType>(MD)) {
+      mOS << "!type " << DITy->getTag() << ':' << DITy->getName() << ':'
+          << DITy->getSizeInBits() << ':' << DITy->getOffsetInBits();
+    } else if (auto *DIN = dyn_cast<DINode>(MD)) {
+      mOS << "!di " << DIN->getTag();
+    } else if (auto *VAM = dyn_cast<ValueAsMetadata>(MD)) {
+      writeOperand(VAM->getValue());
+    } else if (auto *Str = dyn_cast<MDString>(MD)) {
+      mOS << "!\"" << Str->getString() << '"';
+    } else if (auto *N = dyn_cast<MDNode>(MD)) {
+      // Nodes are numbered in order of the first use, so self-referencing
+      // nodes (for example, !llvm.loop) are supported.
+      auto Info = mMDNodes.try_emplace(N, mMDNodes.size());
+      mOS << '!' << Info.first->second;
+      if (!Info.second)
+        return;
+      mOS << '{';
+      for (auto &Op : N->operands()) {
+        writeMetadata(Op);
+        mOS << ',';
+      }
+      mOS << '}';
+    } else {
+      mOS << "!md";
+    }
+  }
+
+  const Function &mF;
+  ModuleSlotTracker &mMST;
+  raw_ostream &mOS;
+  DenseMap<const Value *, unsigned> mLocals;
+  SmallVector<StringRef, 16> mMDKindNames;
+  SmallPtrSet<const StructType *, 8> mStructs;
+  SmallPtrSet<const GlobalValue *, 8> mGlobals;
+  DenseMap<const MDNode *, unsigned> mMDNodes;
+};
+
+class FunctionFingerprintPass : public ModulePass, private bcl::Uncopyable {
+public:
+  static char ID;
+
+  explicit FunctionFingerprintPass(ArrayRef<std::string> CacheTags = {})
+      : ModulePass(ID), mCacheTags(CacheTags.begin(), CacheTags.end()) {
+    initializeFunctionFingerprintPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+private:
+  std::vector<std::string> mCacheTags;
+  FunctionCachedResults mCachedResults;
+};
+}
+
+char FunctionFingerprintPass::ID = 0;
+INITIALIZE_PASS_BEGIN(FunctionFingerprintPass, "function-fingerprint",
+                      "Function Fingerprint Analysis", true, true)
+INITIALIZE_PASS_DEPENDENCY(CallGraphWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(GlobalLiveMemoryWrapper)
+INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
+INITIALIZE_PASS_DEPENDENCY(FunctionCachedResultsWrapper)
+INITIALIZE_PASS_END(FunctionFingerprintPass, "function-fingerprint",
+                    "Function Fingerprint Analysis", true, true)
+
+template<> char FunctionCachedResultsWrapper::ID = 0;
+INITIALIZE_PASS(FunctionCachedResultsWrapper, "function-cached-results-iw",
+  "Cached Analysis Results (Immutable Wrapper)", true, true)
+
+void FunctionFingerprintPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.addRequired<CallGraphWrapperPass>();
+  AU.addRequired<GlobalLiveMemoryWrapper>();
+  AU.addRequired<GlobalOptionsImmutableWrapper>();
+  AU.addRequired<FunctionCachedResultsWrapper>();
+  AU.setPreservesAll();
+}
+
+bool FunctionFingerprintPass::runOnModule(Module &M) {
+  auto &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+  auto &LiveWrapper = getAnalysis<GlobalLiveMemoryWrapper>();
+  auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
+  mCachedResults.clear();
+  getAnalysis<FunctionCachedResultsWrapper>().set(mCachedResults);
+  ModuleSlotTracker MST(&M);
+  DenseMap<Function *, std::string> Fingerprints;
+  // Write fingerprints of callees which are not in a specified SCC.
+  auto writeCallees = [&Fingerprints](ArrayRef<CallGraphNode *> SCC,
+                                      raw_ostream &OS) {
+    std::vector<std::string> Callees;
+    for (auto *Node : SCC)
+      for (auto &CallRecord : *Node) {
+        auto *Callee = CallRecord.second->getFunction();
+        if (!Callee) {
+          Callees.push_back("?");
+          continue;
+        }
+        if (is_contained(SCC, CallRecord.second))
+          continue;
+        auto I = Fingerprints.find(Callee);
+        Callees.push_back(I != Fingerprints.end()
+                              ? I->second
+                              : (Callee->getName() + ":" +
+                                 Callee->getAttributes().getAsString(
+                                     AttributeList::FunctionIndex, false))
+                                    .str());
+      }
+    llvm::sort(Callees);
+    for (auto &C : Callees)
+      OS << C << '\0';
+  };
+  // Write live memory locations in a function (they are sorted to avoid
+  // dependence on the order of locations in a set).
+  auto writeLive = [&LiveWrapper](FunctionWriter &FW, Function &F,
+                                  raw_ostream &OS) {
+    if (!LiveWrapper)
+      return;
+    auto I = LiveWrapper->find(&F);
+    if (I == LiveWrapper->end())
+      return;
+    auto writeSet = [&FW, &OS](const MemorySet<MemoryLocationRange> &Set) {
+      std::vector<std::string> Locs;
+      for (auto &Loc : Set)
+        Locs.push_back(FW.toString(Loc));
+      llvm::sort(Locs);
+      for (auto &L : Locs)
+        OS << L << '\0';
+      OS << '\0';
+    };
+    writeSet(I->get<LiveSet>()->getIn());
+    writeSet(I->get<LiveSet>()->getOut());
+  };
+  // Call graph SCCs are visited in post order, so callees are visited before
+  // callers. Functions from the same SCC share the fingerprint of the SCC
+  // combined with their own IR.
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG); !I.isAtEnd(); ++I) {
+    const std::vector<CallGraphNode *> &SCC = *I;
+    std::vector<std::pair<Function *, std::string>> Locals;
+    for (auto *Node : SCC) {
+      auto *F = Node->getFunction();
+      if (!F || F->isDeclaration())
+        continue;
+      raw_sha1_ostream OS;
+      FunctionWriter FW(*F, MST, OS);
+      FW.write();
+      writeLive(FW, *F, OS);
+      Locals.emplace_back(F, toHex(OS.sha1(), true));
+    }
+    if (Locals.empty())
+      continue;
+    raw_sha1_ostream SCCOS;
+    std::vector<std::string> SCCLocals;
+    for (auto &L : Locals)
+      SCCLocals.push_back(L.second);
+    llvm::sort(SCCLocals);
+    for (auto &L : SCCLocals)
+      SCCOS << L << '\0';
+    writeCallees(SCC, SCCOS);
+    auto SCCHash = toHex(SCCOS.sha1(), true);
+    for (auto &L : Locals) {
+      raw_sha1_ostream OS;
+      OS << SCCHash << '\0' << L.second;
+      Fingerprints.try_emplace(L.first, toHex(OS.sha1(), true));
+    }
+  }
+  bool UseCache = GO.IncrementalAnalysis && !GO.AnalysisCache.empty() &&
+                  !mCacheTags.empty();
+  AnalysisCache Cache(GO.AnalysisCache);
+  for (auto &FP : Fingerprints) {
+    addFnAttr(*FP.first, AttrKind::Fingerprint, FP.second);
+    if (!UseCache)
+      continue;
+    // Results are loaded here instead of checking their existence only.
+    // So, results for a marked function cannot disappear from the cache
+    // before they are printed (analysis of the function will be skipped).
+    StringMap<std::string> Results;
+    if (all_of(mCacheTags,
+               [&Cache, &FP, &GO, &Results](const std::string &Tag) {
+                 auto R = Cache.lookup(
+                     AnalysisCache::computeKey(FP.second, GO, Tag));
+                 if (!R)
+                   return false;
+                 Results.try_emplace(Tag, std::move(*R));
+                 return true;
+               })) {
+      mCachedResults.try_emplace(FP.first, std::move(Results));
+      addFnAttr(*FP.first, AttrKind::CachedResults);
+      ++NumCachedFunc;
+    }
+  }
+  return !Fingerprints.empty();
+}
+
+ModulePass *llvm::createFunctionFingerprintPass(
+    ArrayRef<std::string> CacheTags) {
+  return new FunctionFingerprintPass(CacheTags);
+}
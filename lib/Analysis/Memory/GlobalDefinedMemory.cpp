@@ -25,6 +25,8 @@
 #include "tsar/Analysis/Memory/DefinedMemory.h"
 #include "tsar/Analysis/Memory/EstimateMemory.h"
 #include "tsar/Analysis/Memory/Passes.h"
+#include "tsar/Support/GlobalOptions.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Support/PassProvider.h"
 #include <bcl/utility.h>
 #include <llvm/ADT/SCCIterator.h>
@@ -121,6 +123,8 @@ INITIALIZE_PASS_DEPENDENCY(CallGraphWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryProvider)
 INITIALIZE_PASS_DEPENDENCY(GlobalDefinedMemoryWrapper)
+INITIALIZE_PASS_DEPENDENCY(DefUseSummaryCacheWrapper)
+INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
 INITIALIZE_PASS_END(GlobalDefinedMemory, "global-def-mem",
                     "Global Defined Memory Analysis", true, true)
 
@@ -129,6 +133,8 @@ void GlobalDefinedMemory::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<GlobalDefinedMemoryWrapper>();
   AU.addRequired<CallGraphWrapperPass>();
   AU.addRequired<TargetLibraryInfoWrapperPass>();
+  AU.addRequired<DefUseSummaryCacheWrapper>();
+  AU.addRequired<GlobalOptionsImmutableWrapper>();
   AU.setPreservesAll();
 }
 
@@ -144,8 +150,18 @@ bool GlobalDefinedMemory::runOnModule(Module &SCC) {
   auto &Wrapper = getAnalysis<GlobalDefinedMemoryWrapper>();
   if (!Wrapper)
     return false;
+  PassProfileRegion Profile(*this, nullptr);
   Wrapper->clear();
+  // Cached def-use sets may refer to the cleared results of interprocedural
+  // analysis, so they should be recalculated. Sets which have not been used
+  // at the previous stage are also dropped to bound the size of the cache.
+  auto &DUCache = getAnalysis<DefUseSummaryCacheWrapper>();
+  if (DUCache)
+    DUCache->startStage();
+  auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
   auto &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+  DataFlowStatistics DFStats;
+  bool CollectStats = isDataFlowStatisticsRequested(Profile);
   for (scc_iterator<CallGraph *> SCC = scc_begin(&CG); !SCC.isAtEnd(); ++SCC) {
     /// TODO (kaniandr@gmail.com): implement analysis in case of recursion.
     if (SCC->size() > 1)
@@ -170,11 +186,26 @@ bool GlobalDefinedMemory::runOnModule(Module &SCC) {
     auto *DFF = cast<DFFunction>(RegInfo.getTopLevelRegion());
     DefinedMemoryInfo DefInfo;
     ReachDFFwk ReachDefFwk(AT, TLI, DT, DefInfo, *Wrapper);
-    solveDataFlowUpward(&ReachDefFwk, DFF);
+    if (DUCache)
+      ReachDefFwk.setSummaryCache(&DUCache.get());
+    if (CollectStats)
+      ReachDefFwk.setStatistics(&DFStats);
+    if (GO.NoLocationNumbering)
+      ReachDefFwk.disableLocationNumbering();
+    ReachDefFwk.setWorklistForced(GO.DataFlowWorklist);
+    if (GO.SparseReachDefinitions)
+      solveReachDefinitionsSparsely(&ReachDefFwk, DFF);
+    else
+      solveDataFlowUpward(&ReachDefFwk, DFF);
     auto DefUseSetItr = ReachDefFwk.getDefInfo().find(DFF);
     assert(DefUseSetItr != ReachDefFwk.getDefInfo().end() &&
            "Def-use set must exist for a function!");
-    Wrapper->try_emplace(F, std::move(DefUseSetItr->get<DefUseSet>()));
+    // The def-use set is owned by a local arena, so move its content to
+    // the heap to keep it after analysis of the current function.
+    Wrapper->try_emplace(F, std::make_unique<DefUseSet>(
+      std::move(*DefUseSetItr->get<DefUseSet>())));
   }
+  if (CollectStats)
+    reportDataFlowStatistics(DFStats, Profile);
   return false;
 }
@@ -26,6 +26,7 @@
 #include "tsar/Analysis/Memory/LiveMemory.h"
 #include "tsar/Analysis/Memory/MemoryAccessUtils.h"
 #include "tsar/Support/GlobalOptions.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Support/PassProvider.h"
 #include <llvm/ADT/SCCIterator.h>
 #include <llvm/ADT/SmallPtrSet.h>
@@ -237,6 +238,7 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
   auto &Wrapper = getAnalysis<GlobalLiveMemoryWrapper>();
   if (!Wrapper)
     return false;
+  PassProfileRegion Profile(*this, nullptr);
   Wrapper->clear();
   auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
   auto &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
@@ -270,7 +272,13 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
         [&GDM](GlobalDefinedMemoryWrapper &Wrapper) { Wrapper.set(*GDM); });
   }
   auto &DL = M.getDataLayout();
+  std::unique_ptr<ThreadPool> Pool;
+  if (GO.DataFlowThreads > 0)
+    Pool = std::make_unique<ThreadPool>(
+      hardware_concurrency(GO.DataFlowThreads));
   LiveMemoryForCalls LiveSetForCalls;
+  DataFlowStatistics DFStats;
+  bool CollectStats = isDataFlowStatisticsRequested(Profile);
   for (auto *CGN : llvm::reverse(Worklist)) {
     auto F = CGN->getFunction();
     if (!F || F->empty())
@@ -306,7 +314,17 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
     auto &LS = LiveItr->get<LiveSet>();
     LS->setOut(MayLives);
     LiveDFFwk LiveFwk(IntraLiveInfo, DefInfo, DT);
-    solveDataFlowDownward(&LiveFwk, TopRegion);
+    if (CollectStats)
+      LiveFwk.setStatistics(&DFStats);
+    LiveFwk.setWorklistForced(GO.DataFlowWorklist);
+    if (!GO.NoLiveMemoryBits && solveLiveMemoryInBits(&LiveFwk, TopRegion)) {
+      // Results have been obtained with the use of bit vectors.
+    } else if (Pool) {
+      LiveFwk.reserve(TopRegion);
+      solveDataFlowDownward(&LiveFwk, TopRegion, *Pool);
+    } else {
+      solveDataFlowDownward(&LiveFwk, TopRegion);
+    }
     auto &TLI = getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(*F);
     for (auto &CallRecord : *CGN) {
       Function *Callee = CallRecord.second->getFunction();
@@ -336,6 +354,8 @@ bool GlobalLiveMemory::runOnModule(Module &M) {
     }
     Wrapper->try_emplace(F, std::move(IntraLiveInfo[TopRegion]));
   }
+  if (CollectStats)
+    reportDataFlowStatistics(DFStats, Profile);
   LLVM_DEBUG(visitedFunctionsLog(LiveSetForCalls));
   return false;
 }
@@ -24,13 +24,17 @@
 
 #include "tsar/Analysis/Memory/LiveMemory.h"
 #include "tsar/Analysis/Memory/DefinedMemory.h"
+#include "tsar/Support/GlobalOptions.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Unparse/Utils.h"
 #include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/Statistic.h>
 #include <llvm/Analysis/ValueTracking.h>
 #ifdef LLVM_DEBUG
 # include <llvm/IR/Dominators.h>
 #endif
 #include <llvm/Support/Debug.h>
+#include <bitset>
 
 using namespace llvm;
 using namespace tsar;
@@ -38,16 +42,21 @@ using namespace tsar;
 #undef DEBUG_TYPE
 #define DEBUG_TYPE "live-mem"
 
+STATISTIC(NumBitLiveFunctions,
+  "Number of functions analyzed with the use of bit vectors");
+
 char LiveMemoryPass::ID = 0;
 INITIALIZE_PASS_BEGIN(LiveMemoryPass, "live-mem",
   "Live Memory Analysis", false, true)
   INITIALIZE_PASS_DEPENDENCY(DFRegionInfoPass)
   INITIALIZE_PASS_DEPENDENCY(DefinedMemoryPass)
   INITIALIZE_PASS_DEPENDENCY(GlobalLiveMemoryWrapper)
+  INITIALIZE_PASS_DEPENDENCY(GlobalOptionsImmutableWrapper)
 INITIALIZE_PASS_END(LiveMemoryPass, "live-mem",
   "Live Memory Analysis", false, true)
 
   bool llvm::LiveMemoryPass::runOnFunction(Function &F) {
+  PassProfileRegion Profile(*this, &F);
   auto &RegionInfo = getAnalysis<DFRegionInfoPass>().getRegionInfo();
   auto &DefInfo = getAnalysis<DefinedMemoryPass>().getDefInfo();
   DominatorTree *DT = nullptr;
@@ -94,7 +103,26 @@ INITIALIZE_PASS_END(LiveMemoryPass, "live-mem",
     LS->setOut(std::move(MayLives));
   }
   LiveDFFwk LiveFwk(mLiveInfo, DefInfo, DT);
-  solveDataFlowDownward(&LiveFwk, DFF);
+  auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
+  DataFlowStatistics DFStats;
+  bool CollectStats = isDataFlowStatisticsRequested(Profile);
+  if (CollectStats)
+    LiveFwk.setStatistics(&DFStats);
+  LiveFwk.setWorklistForced(GO.DataFlowWorklist);
+  if (!GO.NoLiveMemoryBits && solveLiveMemoryInBits(&LiveFwk, DFF)) {
+    // Results have been obtained with the use of bit vectors.
+  } else if (GO.DataFlowThreads > 0) {
+    if (!mPool)
+      mPool = std::make_unique<ThreadPool>(
+        hardware_concurrency(GO.DataFlowThreads));
+    LiveFwk.reserve(DFF);
+    solveDataFlowDownward(&LiveFwk, DFF, *mPool);
+  } else {
+    solveDataFlowDownward(&LiveFwk, DFF);
+  }
+  if (CollectStats)
+    reportDataFlowStatistics(DFStats, Profile);
+  Profile.addCounter("df-nodes", mLiveInfo.size());
   return false;
 }
 
@@ -102,6 +130,7 @@ void LiveMemoryPass::getAnalysisUsage(AnalysisUsage & AU) const {
   AU.addRequired<DFRegionInfoPass>();
   AU.addRequired<DefinedMemoryPass>();
   AU.addRequired<GlobalLiveMemoryWrapper>();
+  AU.addRequired<GlobalOptionsImmutableWrapper>();
   AU.setPreservesAll();
 }
 
@@ -109,6 +138,14 @@ FunctionPass * llvm::createLiveMemoryPass() {
   return new LiveMemoryPass();
 }
 
+void LiveDFFwk::reserve(DFRegion *R) {
+  assert(R && "Region must not be null!");
+  for (auto *N : R->getNodes())
+    mLiveInfo->try_emplace(N, std::make_unique<LiveSet>());
+  for (auto *Inner : make_range(R->region_begin(), R->region_end()))
+    reserve(Inner);
+}
+
 void DataFlowTraits<LiveDFFwk *>::initialize(
   DFNode *N, LiveDFFwk *DFF, GraphType) {
   assert(N && "Node must not be null!");
@@ -167,3 +204,230 @@ bool DataFlowTraits<LiveDFFwk*>::transferFunction(
   }
   return false;
 }
+
+namespace {
+/// \brief Data-flow framework which is used to find live locations with the
+/// use of bit vectors of a fixed size.
+///
+/// Each location which may be alive in a function is associated with an index
+/// in a bit vector. So, gen/kill sets and live sets of all nodes are bit
+/// vectors.
+class LiveBitsDFFwk : private bcl::Uncopyable {
+  using LocationSet = DataFlowTraits<LiveDFFwk *>::ValueType;
+public:
+  /// Maximum number of locations (four 64-bit words).
+  enum : unsigned { MaxLocations = 256 };
+
+  using BitsT = std::bitset<MaxLocations>;
+
+  /// Live locations and gen/kill sets for a data-flow node.
+  struct LiveBits {
+    BitsT In;
+    BitsT Out;
+    BitsT Use;
+    BitsT Def;
+  };
+
+  explicit LiveBitsDFFwk(LiveDFFwk &Fwk) : mFwk(&Fwk) {}
+
+  /// \brief Enumerates locations and builds gen/kill sets for all nodes of
+  /// a specified region and its internal regions.
+  ///
+  /// \return False if locations can not be represented as bit vectors.
+  bool initialize(DFRegion *R) {
+    auto LiveItr = mFwk->getLiveInfo().find(R);
+    assert(LiveItr != mFwk->getLiveInfo().end() && LiveItr->get<LiveSet>() &&
+      "Data-flow value must be specified!");
+    auto &LS = LiveItr->get<LiveSet>();
+    auto &LB = mBits[R];
+    if (!toBits(LS->getIn(), LB.In) || !toBits(LS->getOut(), LB.Out) ||
+        !initializeUses(R))
+      return false;
+    initializeKills();
+    return true;
+  }
+
+  /// Stores live locations for each node in the original framework.
+  void finalize() {
+    auto &LiveInfo = mFwk->getLiveInfo();
+    for (auto &NodeBits : mBits) {
+      auto &LS = LiveInfo.try_emplace(NodeBits.first,
+        std::make_unique<LiveSet>()).first->get<LiveSet>();
+      LS->setIn(toSet(NodeBits.second.In));
+      LS->setOut(toSet(NodeBits.second.Out));
+    }
+  }
+
+  /// Returns collector of statistics of data-flow solvers or nullptr.
+  DataFlowStatistics * getStatistics() const noexcept {
+    return mFwk->getStatistics();
+  }
+
+  /// Returns true if a worklist should be used for acyclic graphs too.
+  bool isWorklistForced() const noexcept { return mFwk->isWorklistForced(); }
+
+  /// Returns bit vectors for a specified node.
+  LiveBits & getBits(DFNode *N) {
+    auto I = mBits.find(N);
+    assert(I != mBits.end() && "Data-flow value must be specified!");
+    return I->second;
+  }
+
+private:
+  /// Returns index of a specified location or -1 if the location overlaps
+  /// some of known locations or there are too many locations.
+  int getOrAddLocation(const MemoryLocationRange &Loc) {
+    using MemoryInfo = MemorySetInfo<MemoryLocationRange>;
+    auto &Indices = mPtrToLocations[Loc.Ptr];
+    for (auto Idx : Indices) {
+      auto &Curr = mLocations[Idx];
+      if (Curr == Loc)
+        return Idx;
+      // Use the same condition as MemorySet::insert() does to merge locations.
+      if (MemoryInfo::sizecmp(MemoryInfo::getUpperBound(Curr),
+                              MemoryInfo::getLowerBound(Loc)) >= 0 &&
+          MemoryInfo::sizecmp(MemoryInfo::getLowerBound(Curr),
+                              MemoryInfo::getUpperBound(Loc)) <= 0)
+        return -1;
+    }
+    if (mLocations.size() == MaxLocations)
+      return -1;
+    Indices.push_back(mLocations.size());
+    mLocations.push_back(Loc);
+    return mLocations.size() - 1;
+  }
+
+  bool toBits(const LocationSet &Set, BitsT &Bits) {
+    for (auto &Loc : Set) {
+      auto Idx = getOrAddLocation(Loc);
+      if (Idx < 0)
+        return false;
+      Bits.set(Idx);
+    }
+    return true;
+  }
+
+  LocationSet toSet(const BitsT &Bits) const {
+    LocationSet Set;
+    for (unsigned Idx = 0, EIdx = mLocations.size(); Idx < EIdx; ++Idx)
+      if (Bits.test(Idx))
+        Set.insert(mLocations[Idx]);
+    return Set;
+  }
+
+  bool initializeUses(DFRegion *R) {
+    auto &DefInfo = mFwk->getDefInfo();
+    for (auto *N : R->getNodes()) {
+      auto &LB = mBits[N];
+      // Note, that transfer function is never evaluated for the exit node and
+      // it does not use def-use set of the entry node.
+      if (isa<DFEntry>(N) || isa<DFExit>(N))
+        continue;
+      auto DefItr = DefInfo.find(N);
+      if (DefItr == DefInfo.end() || !DefItr->get<DefUseSet>() ||
+          !toBits(DefItr->get<DefUseSet>()->getUses(), LB.Use))
+        return false;
+    }
+    for (auto *Inner : make_range(R->region_begin(), R->region_end()))
+      if (!initializeUses(Inner))
+        return false;
+    return true;
+  }
+
+  /// Builds kill sets when all locations have been enumerated.
+  void initializeKills() {
+    auto &DefInfo = mFwk->getDefInfo();
+    for (auto &NodeBits : mBits) {
+      auto DefItr = DefInfo.find(NodeBits.first);
+      if (DefItr == DefInfo.end() || !DefItr->get<DefUseSet>())
+        continue;
+      auto &DU = DefItr->get<DefUseSet>();
+      for (auto &Loc : DU->getDefs()) {
+        auto PtrItr = mPtrToLocations.find(Loc.Ptr);
+        if (PtrItr == mPtrToLocations.end())
+          continue;
+        for (auto Idx : PtrItr->second)
+          if (DU->hasDef(mLocations[Idx]))
+            NodeBits.second.Def.set(Idx);
+      }
+    }
+  }
+
+  LiveDFFwk *mFwk;
+  DenseMap<DFNode *, LiveBits> mBits;
+  std::vector<MemoryLocationRange> mLocations;
+  DenseMap<const Value *, SmallVector<unsigned, 1>> mPtrToLocations;
+};
+}
+
+namespace tsar {
+template<> struct DataFlowTraits<LiveBitsDFFwk *> {
+  typedef Backward<DFRegion *> GraphType;
+  typedef LiveBitsDFFwk::BitsT ValueType;
+  static ValueType topElement(LiveBitsDFFwk *, GraphType) {
+    return ValueType();
+  }
+  static ValueType boundaryCondition(LiveBitsDFFwk *DFF, GraphType G) {
+    // See DataFlowTraits<LiveDFFwk *>::boundaryCondition().
+    auto &LB = DFF->getBits(G.Graph);
+    return LB.In | LB.Out;
+  }
+  static void setValue(ValueType V, DFNode *N, LiveBitsDFFwk *DFF) {
+    DFF->getBits(N).In = V;
+  }
+  static const ValueType & getValue(DFNode *N, LiveBitsDFFwk *DFF) {
+    return DFF->getBits(N).In;
+  }
+  static void initialize(DFNode *, LiveBitsDFFwk *, GraphType) {}
+  static DataFlowStatistics * getStatistics(LiveBitsDFFwk *DFF) {
+    return DFF->getStatistics();
+  }
+  static bool isWorklistForced(LiveBitsDFFwk *DFF) {
+    return DFF->isWorklistForced();
+  }
+  static std::size_t size(const ValueType &V) { return V.count(); }
+  static void meetOperator(
+      const ValueType &LHS, ValueType &RHS, LiveBitsDFFwk *, GraphType) {
+    RHS |= LHS;
+  }
+  static bool transferFunction(
+      ValueType V, DFNode *N, LiveBitsDFFwk *DFF, GraphType) {
+    auto &LB = DFF->getBits(N);
+    LB.Out = V;
+    auto NewIn = isa<DFEntry>(N) ? LB.Out : LB.Use | (LB.Out & ~LB.Def);
+    if (NewIn == LB.In)
+      return false;
+    LB.In = NewIn;
+    return true;
+  }
+};
+
+template<> struct RegionDFTraits<LiveBitsDFFwk *> :
+    DataFlowTraits<LiveBitsDFFwk *> {
+  static void expand(LiveBitsDFFwk *, GraphType G) {
+    RegionDFTraits<LiveDFFwk *>::expand(nullptr, G);
+  }
+  static void collapse(LiveBitsDFFwk *, GraphType G) {
+    RegionDFTraits<LiveDFFwk *>::collapse(nullptr, G);
+  }
+  typedef DFRegion::region_iterator region_iterator;
+  static region_iterator region_begin(GraphType G) {
+    return G.Graph->region_begin();
+  }
+  static region_iterator region_end(GraphType G) {
+    return G.Graph->region_end();
+  }
+};
+}
+
+bool tsar::solveLiveMemoryInBits(LiveDFFwk *DFF, DFRegion *R) {
+  assert(DFF && "Data-flow framework must not be null!");
+  assert(R && "Region must not be null!");
+  LiveBitsDFFwk BitsFwk(*DFF);
+  if (!BitsFwk.initialize(R))
+    return false;
+  solveDataFlowDownward(&BitsFwk, R);
+  BitsFwk.finalize();
+  ++NumBitLiveFunctions;
+  return true;
+}
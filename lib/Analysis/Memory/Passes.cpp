@@ -45,5 +45,6 @@ void llvm::initializeMemoryAnalysis(PassRegistry &Registry) {
   initializeDelinearizationPassPass(Registry);
   initializeGlobalDefinedMemoryPass(Registry);
   initializeGlobalLiveMemoryPass(Registry);
+  initializeFunctionFingerprintPassPass(Registry);
   initializeDIArrayAccessWrapperPass(Registry);
 }
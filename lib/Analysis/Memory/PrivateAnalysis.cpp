@@ -40,6 +40,7 @@
 #include "tsar/Core/Query.h"
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/IRUtils.h"
+#include "tsar/Support/PassProfile.h"
 #include "tsar/Support/Utils.h"
 #include "tsar/Unparse/Utils.h"
 #include <llvm/ADT/DenseMap.h>
@@ -97,6 +98,9 @@ struct DependenceCache {
     std::pair<std::unique_ptr<Dependence>, unsigned short>;
   using CacheT = DenseMap<SrcDstPair, DependenceConfusedPair>;
   CacheT Impl;
+  /// Number of dependence tests which have been issued, including tests
+  /// which results have been found in the cache.
+  unsigned NumTests = 0;
 };
 }
 }
@@ -106,6 +110,10 @@ bool PrivateRecognitionPass::runOnFunction(Function &F) {
   auto &GlobalOpts = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
   if (!GlobalOpts.AnalyzeLibFunc && hasFnAttr(F, AttrKind::LibFunc))
     return false;
+  // Printed results of analysis for this function are available in a cache.
+  if (hasFnAttr(F, AttrKind::CachedResults))
+    return false;
+  PassProfileRegion Profile(*this, &F);
 #ifdef LLVM_DEBUG
   for (const BasicBlock &BB : F)
     assert((&F.getEntryBlock() == &BB || BB.getNumUses() > 0 )&&
@@ -126,6 +134,9 @@ bool PrivateRecognitionPass::runOnFunction(Function &F) {
   AliasTreeRelation AliasSTR(mAliasTree);
   DependenceCache Cache;
   resolveCandidats(Numbers, AliasSTR, DFF, Cache);
+  Profile.addCounter("alias-nodes", mAliasTree->size());
+  Profile.addCounter("loops", mPrivates.size());
+  Profile.addCounter("dependence-tests", Cache.NumTests);
   return false;
 }
 
@@ -546,6 +557,7 @@ void PrivateRecognitionPass::collectDependencies(Loop *L, DependenceMap &Deps,
             LLVM_DEBUG(dbgs() << "[PRIVATE]: ignore input dependence\n");
             continue;
           }
+          ++Cache.NumTests;
           auto CacheItr = Cache.Impl.find(std::make_pair(*SrcItr, *DstItr));
           unsigned short ConfusedLevels;
           Dependence *Dep = nullptr;
@@ -833,15 +845,19 @@ void PrivateRecognitionPass::propagateTraits(
     AliasMap &NodeTraits, DependenceMap &Deps, DependenceSet &DS) {
   LLVM_DEBUG(dbgs() << "[PRIVATE]: propagate traits\n");
   std::stack<TraitPair> ChildTraits;
-  auto *Prev = mAliasTree->getTopLevelNode();
-  // Such initialization of Prev is sufficient for the first iteration, then
-  // it will be overwritten.
-  for (auto *N : post_order(mAliasTree)) {
+  // Traits are propagated for each region, so use compact layout of the alias
+  // tree which is shared between regions instead of walking over the tree.
+  auto &Layout = mAliasTree->getLayout();
+  AliasTreeLayout::index_type Prev = 0;
+  // Such initialization of Prev (the root of the tree) is sufficient for the
+  // first iteration, then it will be overwritten.
+  for (auto Idx : Layout.postorder_indices()) {
+    auto *N = Layout.getNode(Idx);
     auto NTItr = NodeTraits.find(N);
-    if (Prev->getParent(*mAliasTree) == N) {
+    if (Layout.getParent(Prev) == Idx) {
       // All children has been analyzed and now it is possible to combine
       // obtained results and to propagate to a current node N.
-      for (auto &Child : make_range(N->child_begin(), N->child_end())) {
+      for (auto Child : Layout.children(Idx)) {
         // This for loop is used to extract all necessary information from
         // the ChildTraits stack. Number of pop() calls should be the same
         // as a number of children.
@@ -877,7 +893,7 @@ void PrivateRecognitionPass::propagateTraits(
     storeResults(
       Numbers, R, *N, ExplicitAccesses, ExplicitUnknowns, Deps, NT, DS);
     ChildTraits.push(std::move(NT));
-    Prev = N;
+    Prev = Idx;
   }
   sanitizeCombinedTraits(DS);
   std::vector<const AliasNode *> Coverage;
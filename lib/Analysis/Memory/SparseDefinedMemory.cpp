@@ -0,0 +1,479 @@
+//===- SparseDefinedMemory.cpp - Sparse Reach Definitions -------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an alternative engine to find reach definitions.
+// Definitions of locations are grouped by alias nodes and for each group
+// sparse def-use chains in SSA form are built over a data-flow graph of
+// each region. So, data-flow values are propagated through nodes which
+// access memory only.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Analysis/Memory/DefinedMemory.h"
+#include "tsar/Analysis/Memory/EstimateMemory.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/Statistic.h>
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+using namespace tsar;
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "def-mem"
+
+STATISTIC(NumDefVersions, "Number of versions of sparse reach definitions");
+STATISTIC(NumPhiVersions, "Number of merged sparse reach definitions");
+
+namespace {
+/// \brief Finds reach definitions with the use of sparse def-use chains.
+///
+/// Locations are grouped by alias nodes which contain their top-level
+/// estimate memory locations. So, all locations which are based on the same
+/// pointer belong to the same group. In a data-flow graph of each region
+/// a separate version of reach definitions of a group is created for each
+/// node which defines locations from this group and for each node from the
+/// iterated dominance frontier of such nodes (phi-versions). Other nodes
+/// obtain definitions from the immediate dominator.
+class SparseReachDefinitions {
+  enum : unsigned { Undef = ~0u };
+
+  /// Definitions of locations from one group in a data-flow node.
+  struct NodeDefs {
+    SmallVector<MemoryLocationRange, 4> Defs;
+    SmallVector<MemoryLocationRange, 4> MayDefs;
+  };
+
+  /// Version of reach definitions of locations from one group.
+  struct Version {
+    /// Index of a node in reverse post-order.
+    unsigned Node;
+    /// Versions which reach this version, only phi-versions may have
+    /// multiple inputs.
+    SmallVector<unsigned, 2> Inputs;
+    /// Definitions in the node, it is null for phi-versions and the entry.
+    const NodeDefs *Defs = nullptr;
+    bool IsPhi = false;
+    DefinitionInfo Value;
+  };
+
+  /// Sparse def-use chains for a group of locations.
+  struct Group {
+    /// Definitions in nodes (indexes in reverse post-order).
+    MapVector<unsigned, NodeDefs> Defs;
+    /// Versions after nodes which define locations from this group.
+    DenseMap<unsigned, unsigned> DefVersions;
+    /// Phi-versions before nodes from the iterated dominance frontier.
+    DenseMap<unsigned, unsigned> PhiVersions;
+    /// Versions before nodes which have been already found.
+    DenseMap<unsigned, unsigned> ReachIn;
+    unsigned EntryVersion = Undef;
+  };
+
+public:
+  explicit SparseReachDefinitions(ReachDFFwk &DFF) : mDFF(&DFF) {}
+
+  /// Calculates reach definitions for a specified region and all internal
+  /// regions, then collapses internal regions.
+  void solve(DFRegion &R);
+
+private:
+  /// Returns a group of a specified location.
+  const AliasNode * getGroup(const MemoryLocationRange &Loc);
+
+  /// Numbers reachable nodes in reverse post-order and calculates
+  /// immediate dominators and dominance frontiers.
+  void buildDomTree(DFRegion &R);
+
+  /// Distributes definitions of nodes between groups.
+  void collectDefs();
+
+  /// Places versions of a specified group and connects them.
+  void buildVersions(Group &G);
+
+  /// Calculates reach definitions for all versions of a specified group.
+  void solveVersions(Group &G);
+
+  /// Stores calculated reach definitions to data-flow values of nodes.
+  void setReachDefinitions(DFRegion &R);
+
+  /// Returns a version which reaches a node with a specified index.
+  unsigned getReachIn(Group &G, unsigned Idx);
+
+  /// Returns a version which is available after a node with a specified index.
+  unsigned getReachOut(Group &G, unsigned Idx) {
+    auto I = G.DefVersions.find(Idx);
+    return I != G.DefVersions.end() ? I->second : getReachIn(G, Idx);
+  }
+
+  unsigned addVersion(unsigned Node, bool IsPhi, const NodeDefs *Defs) {
+    mVersions.emplace_back();
+    auto &V = mVersions.back();
+    V.Node = Node;
+    V.IsPhi = IsPhi;
+    V.Defs = Defs;
+    auto *N = mDFF->getLocationNumbering();
+    // The entry version is the boundary condition, other versions are
+    // initialized with the top element.
+    V.Value.MustReach = Node == 0 ? LocationDFValue::emptyValue(N) :
+                                    LocationDFValue::fullValue(N);
+    V.Value.MayReach = LocationDFValue::emptyValue(N);
+    return mVersions.size() - 1;
+  }
+
+  ReachDFFwk *mDFF;
+  DenseMap<const Value *, const AliasNode *> mGroupKeys;
+
+  // The following members describe a currently processed region.
+  std::vector<DFNode *> mOrder;
+  DenseMap<DFNode *, unsigned> mIndex;
+  std::vector<unsigned> mIDom;
+  std::vector<SmallVector<unsigned, 2>> mFrontiers;
+  MapVector<const AliasNode *, Group> mGroups;
+  std::vector<Version> mVersions;
+  /// Statistics of convergence, versions are considered as nodes and
+  /// evaluations of versions are considered as transfer functions.
+  DataFlowStatistics::RegionStatistics mStats;
+};
+}
+
+const AliasNode * SparseReachDefinitions::getGroup(
+    const MemoryLocationRange &Loc) {
+  auto I = mGroupKeys.find(Loc.Ptr);
+  if (I != mGroupKeys.end())
+    return I->second;
+  auto &AT = mDFF->getAliasTree();
+  // Locations which are not presented in the alias tree are collected in
+  // a separate group.
+  const AliasNode *Key = nullptr;
+  if (auto *EM = AT.find(Loc))
+    Key = EM->getTopLevelParent()->getAliasNode(AT);
+  return mGroupKeys.try_emplace(Loc.Ptr, Key).first->second;
+}
+
+void SparseReachDefinitions::solve(DFRegion &R) {
+  for (auto *Inner : R.getRegions()) {
+    solve(*Inner);
+    mDFF->collapse(Inner);
+  }
+  DFRegion *Graph = &R;
+  DataFlowTraits<ReachDFFwk *>::GraphType DFG(Graph);
+  for (auto *N : R.getNodes())
+    DataFlowTraits<ReachDFFwk *>::initialize(N, mDFF, DFG);
+  buildDomTree(R);
+  collectDefs();
+  for (auto &GroupItr : mGroups) {
+    buildVersions(GroupItr.second);
+    solveVersions(GroupItr.second);
+  }
+  setReachDefinitions(R);
+  if (auto *Stats = mDFF->getStatistics()) {
+    mStats.Nodes = mVersions.size();
+    Stats->add(mStats);
+  }
+  mStats = DataFlowStatistics::RegionStatistics();
+  mOrder.clear();
+  mIndex.clear();
+  mIDom.clear();
+  mFrontiers.clear();
+  mGroups.clear();
+  mVersions.clear();
+}
+
+void SparseReachDefinitions::buildDomTree(DFRegion &R) {
+  SmallPtrSet<DFNode *, 32> Visited;
+  SmallVector<std::pair<DFNode *, DFNode::succ_iterator>, 16> Stack;
+  auto *Entry = R.getEntryNode();
+  Visited.insert(Entry);
+  Stack.emplace_back(Entry, Entry->succ_begin());
+  while (!Stack.empty()) {
+    auto &Top = Stack.back();
+    if (Top.second == Top.first->succ_end()) {
+      mOrder.push_back(Top.first);
+      Stack.pop_back();
+      continue;
+    }
+    auto *Succ = *Top.second++;
+    if (Visited.insert(Succ).second)
+      Stack.emplace_back(Succ, Succ->succ_begin());
+  }
+  std::reverse(mOrder.begin(), mOrder.end());
+  for (unsigned Idx = 0, IdxE = mOrder.size(); Idx < IdxE; ++Idx)
+    mIndex.try_emplace(mOrder[Idx], Idx);
+  // Immediate dominators are calculated according to the algorithm proposed in
+  // "A Simple, Fast Dominance Algorithm" by Cooper, Harvey and Kennedy.
+  mIDom.assign(mOrder.size(), Undef);
+  mIDom[0] = 0;
+  auto intersect = [this](unsigned LHS, unsigned RHS) {
+    while (LHS != RHS) {
+      while (LHS > RHS)
+        LHS = mIDom[LHS];
+      while (RHS > LHS)
+        RHS = mIDom[RHS];
+    }
+    return LHS;
+  };
+  for (bool IsChanged = true; IsChanged;) {
+    IsChanged = false;
+    for (unsigned Idx = 1, IdxE = mOrder.size(); Idx < IdxE; ++Idx) {
+      unsigned IDom = Undef;
+      for (auto *Pred : mOrder[Idx]->predecessors()) {
+        auto PredItr = mIndex.find(Pred);
+        if (PredItr == mIndex.end() || mIDom[PredItr->second] == Undef)
+          continue;
+        IDom = IDom == Undef ? PredItr->second :
+                               intersect(PredItr->second, IDom);
+      }
+      if (mIDom[Idx] != IDom) {
+        mIDom[Idx] = IDom;
+        IsChanged = true;
+      }
+    }
+  }
+  mFrontiers.resize(mOrder.size());
+  for (unsigned Idx = 1, IdxE = mOrder.size(); Idx < IdxE; ++Idx) {
+    auto *N = mOrder[Idx];
+    if (N->numberOfPredecessors() < 2)
+      continue;
+    for (auto *Pred : N->predecessors()) {
+      auto PredItr = mIndex.find(Pred);
+      if (PredItr == mIndex.end())
+        continue;
+      for (auto Runner = PredItr->second; Runner != mIDom[Idx];
+           Runner = mIDom[Runner]) {
+        auto &DF = mFrontiers[Runner];
+        if (DF.empty() || DF.back() != Idx)
+          DF.push_back(Idx);
+      }
+    }
+  }
+}
+
+void SparseReachDefinitions::collectDefs() {
+  auto &DefInfo = mDFF->getDefInfo();
+  for (unsigned Idx = 1, IdxE = mOrder.size(); Idx < IdxE; ++Idx) {
+    auto DefItr = DefInfo.find(mOrder[Idx]);
+    assert(DefItr != DefInfo.end() && DefItr->get<DefUseSet>() &&
+      "Def-use set must be specified!");
+    auto &DU = *DefItr->get<DefUseSet>();
+    for (auto &Loc : DU.getDefs())
+      mGroups[getGroup(Loc)].Defs[Idx].Defs.push_back(Loc);
+    for (auto &Loc : DU.getMayDefs())
+      mGroups[getGroup(Loc)].Defs[Idx].MayDefs.push_back(Loc);
+  }
+}
+
+void SparseReachDefinitions::buildVersions(Group &G) {
+  G.EntryVersion = addVersion(0, false, nullptr);
+  // Phi-versions are placed in the iterated dominance frontier of nodes
+  // which define locations.
+  SmallVector<unsigned, 16> Worklist;
+  DenseSet<unsigned> Visited;
+  for (auto &Defs : G.Defs) {
+    Worklist.push_back(Defs.first);
+    Visited.insert(Defs.first);
+  }
+  while (!Worklist.empty()) {
+    auto Idx = Worklist.pop_back_val();
+    for (auto DF : mFrontiers[Idx])
+      if (G.PhiVersions.try_emplace(DF, Undef).second) {
+        G.PhiVersions[DF] = addVersion(DF, true, nullptr);
+        ++NumPhiVersions;
+        if (Visited.insert(DF).second)
+          Worklist.push_back(DF);
+      }
+  }
+  for (auto &Defs : G.Defs) {
+    G.DefVersions.try_emplace(Defs.first,
+      addVersion(Defs.first, false, &Defs.second));
+    ++NumDefVersions;
+  }
+  // All versions have been placed, so inputs can be found now.
+  for (auto &Defs : G.Defs)
+    mVersions[G.DefVersions[Defs.first]].Inputs.push_back(
+      getReachIn(G, Defs.first));
+  for (auto &Phi : G.PhiVersions)
+    for (auto *Pred : mOrder[Phi.first]->predecessors()) {
+      auto PredItr = mIndex.find(Pred);
+      if (PredItr != mIndex.end())
+        mVersions[Phi.second].Inputs.push_back(
+          getReachOut(G, PredItr->second));
+    }
+}
+
+unsigned SparseReachDefinitions::getReachIn(Group &G, unsigned Idx) {
+  SmallVector<unsigned, 8> Path;
+  unsigned Result = Undef;
+  for (auto Curr = Idx;;) {
+    auto ReachItr = G.ReachIn.find(Curr);
+    if (ReachItr != G.ReachIn.end()) {
+      Result = ReachItr->second;
+      break;
+    }
+    auto PhiItr = G.PhiVersions.find(Curr);
+    if (PhiItr != G.PhiVersions.end()) {
+      Result = PhiItr->second;
+      break;
+    }
+    if (Curr == 0) {
+      Result = G.EntryVersion;
+      break;
+    }
+    Path.push_back(Curr);
+    Curr = mIDom[Curr];
+    auto DefItr = G.DefVersions.find(Curr);
+    if (DefItr != G.DefVersions.end()) {
+      Result = DefItr->second;
+      break;
+    }
+  }
+  for (auto Curr : Path)
+    G.ReachIn.try_emplace(Curr, Result);
+  return Result;
+}
+
+void SparseReachDefinitions::solveVersions(Group &G) {
+  // Versions are created in order of nodes, so sort them to visit
+  // versions of a node after versions of its dominators.
+  SmallVector<unsigned, 16> Order;
+  for (auto &Phi : G.PhiVersions)
+    Order.push_back(Phi.second);
+  for (auto &Def : G.DefVersions)
+    Order.push_back(Def.second);
+  llvm::sort(Order, [this](unsigned LHS, unsigned RHS) {
+    auto &L = mVersions[LHS], &R = mVersions[RHS];
+    return L.Node < R.Node || L.Node == R.Node && L.IsPhi && !R.IsPhi;
+  });
+  auto *Numbering = mDFF->getLocationNumbering();
+  for (bool IsChanged = true; IsChanged;) {
+    IsChanged = false;
+    ++mStats.Iterations;
+    for (auto VIdx : Order) {
+      auto &V = mVersions[VIdx];
+      ++mStats.TransferCalls;
+      DefinitionInfo New;
+      if (V.IsPhi) {
+        New.MustReach = LocationDFValue::fullValue(Numbering);
+        New.MayReach = LocationDFValue::emptyValue(Numbering);
+        for (auto In : V.Inputs) {
+          New.MustReach.intersect(mVersions[In].Value.MustReach);
+          New.MayReach.merge(mVersions[In].Value.MayReach);
+        }
+      } else {
+        assert(V.Inputs.size() == 1 && V.Defs &&
+          "Version of a definition must have a single input!");
+        // This is similar to the transfer function for dense analysis.
+        auto &In = mVersions[V.Inputs.front()].Value;
+        New.MustReach = In.MustReach;
+        New.MustReach.insert(V.Defs->Defs.begin(), V.Defs->Defs.end());
+        New.MayReach = In.MayReach;
+        New.MayReach.insert(V.Defs->Defs.begin(), V.Defs->Defs.end());
+        New.MayReach.insert(V.Defs->MayDefs.begin(), V.Defs->MayDefs.end());
+      }
+      New.MustReach.uniquify();
+      New.MayReach.uniquify();
+      mStats.MaxSetSize = std::max(mStats.MaxSetSize,
+        static_cast<std::size_t>(New.MayReach.count()));
+      if (New.MustReach != V.Value.MustReach ||
+          New.MayReach != V.Value.MayReach) {
+        V.Value = std::move(New);
+        ++mStats.ChangedNodes;
+        IsChanged = true;
+      }
+    }
+  }
+}
+
+void SparseReachDefinitions::setReachDefinitions(DFRegion &R) {
+  auto &DefInfo = mDFF->getDefInfo();
+  auto *Numbering = mDFF->getLocationNumbering();
+  // Reach definitions are calculated for all locations, so values of nodes
+  // are the same as values obtained by the dense engine. However, values are
+  // not joined over all groups for each node. A value before a node extends
+  // a value after its immediate dominator with phi-versions placed before
+  // the node only. Definitions of other groups do not change on paths from
+  // the dominator and values of phi-versions contain values of the dominator.
+  // A value after a node extends a value before it with definitions in the
+  // node, as versions of definitions do. Values share representation of
+  // locations, so the cost depends on the number of phi-versions and
+  // definitions instead of the number of groups.
+  DenseMap<unsigned, SmallVector<unsigned, 2>> Phis;
+  for (auto &GroupItr : mGroups)
+    for (auto &Phi : GroupItr.second.PhiVersions)
+      Phis[Phi.first].push_back(Phi.second);
+  std::vector<DefinitionInfo> Outs(mOrder.size());
+  Outs[0].MustReach = LocationDFValue::emptyValue(Numbering);
+  Outs[0].MayReach = LocationDFValue::emptyValue(Numbering);
+  for (unsigned Idx = 1, IdxE = mOrder.size(); Idx < IdxE; ++Idx) {
+    auto DefItr = DefInfo.find(mOrder[Idx]);
+    assert(DefItr != DefInfo.end() && DefItr->get<ReachSet>() &&
+      DefItr->get<DefUseSet>() && "Data-flow value must be specified!");
+    auto &RS = *DefItr->get<ReachSet>();
+    auto &DU = *DefItr->get<DefUseSet>();
+    DefinitionInfo In(Outs[mIDom[Idx]]);
+    auto PhiItr = Phis.find(Idx);
+    if (PhiItr != Phis.end()) {
+      for (auto VIdx : PhiItr->second) {
+        In.MustReach.merge(mVersions[VIdx].Value.MustReach);
+        In.MayReach.merge(mVersions[VIdx].Value.MayReach);
+      }
+      In.MustReach.uniquify();
+      In.MayReach.uniquify();
+    }
+    auto &Out = Outs[Idx];
+    Out = In;
+    if (!DU.getDefs().empty() || !DU.getMayDefs().empty()) {
+      // This is similar to the transfer function for dense analysis.
+      Out.MustReach.insert(DU.getDefs().begin(), DU.getDefs().end());
+      Out.MayReach.insert(DU.getDefs().begin(), DU.getDefs().end());
+      Out.MayReach.insert(DU.getMayDefs().begin(), DU.getMayDefs().end());
+      Out.MustReach.uniquify();
+      Out.MayReach.uniquify();
+    }
+    RS.setIn(std::move(In));
+    RS.setOut(Out);
+  }
+  for (auto *N : R.getNodes()) {
+    if (isa<DFEntry>(N) || mIndex.count(N))
+      continue;
+    auto DefItr = DefInfo.find(N);
+    assert(DefItr != DefInfo.end() && DefItr->get<ReachSet>() &&
+      "Data-flow value must be specified!");
+    // This is the top element for nodes which are unreachable from entry.
+    DefinitionInfo Top;
+    Top.MustReach = LocationDFValue::fullValue(Numbering);
+    Top.MayReach = LocationDFValue::emptyValue(Numbering);
+    DefItr->get<ReachSet>()->setIn(Top);
+    DefItr->get<ReachSet>()->setOut(std::move(Top));
+  }
+}
+
+void tsar::solveReachDefinitionsSparsely(ReachDFFwk *DFF, DFRegion *R) {
+  assert(DFF && "Data-flow framework must not be null!");
+  assert(R && "Region must not be null!");
+  SparseReachDefinitions Solver(*DFF);
+  Solver.solve(*R);
+  DFF->collapse(R);
+}
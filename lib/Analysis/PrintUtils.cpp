@@ -26,6 +26,9 @@
 #include "tsar/Analysis/PrintUtils.h"
 #include "tsar/Analysis/Attributes.h"
 #include "tsar/Analysis/Passes.h"
+#include "tsar/Analysis/Memory/FunctionFingerprint.h"
+#include "tsar/Core/TransformationContext.h"
+#include "tsar/Support/AnalysisCache.h"
 #include "tsar/Support/GlobalOptions.h"
 #include <bcl/utility.h>
 #include <llvm/Analysis/LoopInfo.h>
@@ -33,11 +36,15 @@
 #include <llvm/IR/DebugInfoMetadata.h>
 #include <llvm/IR/Function.h>
 #include "llvm/Pass.h"
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/raw_ostream.h>
 
 using namespace llvm;
 using namespace tsar;
 
+static cl::opt<bool> MarkCachedResults("mark-cached-results", cl::Hidden,
+  cl::desc("Mark printed analysis results which are reused from a cache"));
+
 namespace {
 void printLoopsImpl(llvm::raw_ostream &OS, bool FilenameOnly, const Twine &Offset,
                 LoopInfo::reverse_iterator ReverseI,
@@ -90,21 +97,64 @@ class FunctionPassPrinter : public FunctionPass, public bcl::Uncopyable {
 public:
   static char ID;
 
-  FunctionPassPrinter(const PassInfo *PI, raw_ostream &Out)
-    : FunctionPass(ID), mPassToPrint(PI), mOut(Out) {
+  FunctionPassPrinter(const PassInfo *PI, raw_ostream &Out,
+      StringRef Tag = "")
+    : FunctionPass(ID), mPassToPrint(PI), mOut(Out), mTag(Tag) {
     assert(PI && "PassInfo must not be null!");
     auto PassToPrintName = mPassToPrint->getPassName().str();
     mPassName = "FunctionPass Printer: " + PassToPrintName;
   }
 
+  bool doInitialization(Module &M) override {
+    mTfmCtx = nullptr;
+    if (auto *TEP = getAnalysisIfAvailable<TransformationEnginePass>())
+      mTfmCtx = TEP->getContext(M);
+    mNumDiags = mTfmCtx ? mTfmCtx->getNumReportedDiagnostics() : 0;
+    return false;
+  }
+
   bool runOnFunction(Function &F) override {
     auto &GO = getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
     if (!GO.AnalyzeLibFunc && tsar::hasFnAttr(F, tsar::AttrKind::LibFunc))
       return false;
-    mOut << "Printing analysis '" << mPassToPrint->getPassName()
-      << "' for function '" << F.getName() << "':\n";
-    getAnalysisID<Pass>(mPassToPrint->getTypeInfo()).
-      print(mOut, F.getParent());
+    auto FingerprintAttr =
+      F.getFnAttribute(tsar::getAsString(tsar::AttrKind::Fingerprint));
+    if (mTag.empty() || !GO.IncrementalAnalysis || GO.AnalysisCache.empty() ||
+        !FingerprintAttr.isStringAttribute()) {
+      printResults(F, mOut);
+      return false;
+    }
+    if (tsar::hasFnAttr(F, tsar::AttrKind::CachedResults)) {
+      // Analysis of this function has been skipped, so results must be
+      // taken from the cache. They have been loaded before the function
+      // was marked.
+      auto *Wrapper = getAnalysisIfAvailable<FunctionCachedResultsWrapper>();
+      assert(Wrapper && *Wrapper && "Cached results must be available!");
+      auto FuncItr = (*Wrapper)->find(&F);
+      assert(FuncItr != (*Wrapper)->end() &&
+        "Cached results must be loaded for a marked function!");
+      auto ResultItr = FuncItr->second.find(mTag);
+      assert(ResultItr != FuncItr->second.end() &&
+        "Cached results must be loaded for each tag!");
+      if (MarkCachedResults)
+        mOut << "Reusing cached results for function '" << F.getName()
+             << "':\n";
+      mOut << ResultItr->second;
+      return false;
+    }
+    AnalysisCache Cache(GO.AnalysisCache);
+    auto Key = AnalysisCache::computeKey(
+      FingerprintAttr.getValueAsString(), GO, mTag);
+    std::string Results;
+    raw_string_ostream OS(Results);
+    printResults(F, OS);
+    OS.flush();
+    // Diagnostics are not cached, so do not store results if some diagnostics
+    // have been reported after the beginning of analysis (conservatively
+    // assume that they relate to the current function).
+    if (!mTfmCtx || mTfmCtx->getNumReportedDiagnostics() == mNumDiags)
+      Cache.store(Key, Results);
+    mOut << Results;
     return false;
   }
 
@@ -124,9 +174,19 @@ public:
   }
 
 private:
+  void printResults(Function &F, raw_ostream &OS) {
+    OS << "Printing analysis '" << mPassToPrint->getPassName()
+      << "' for function '" << F.getName() << "':\n";
+    getAnalysisID<Pass>(mPassToPrint->getTypeInfo()).
+      print(OS, F.getParent());
+  }
+
   const PassInfo *mPassToPrint;
   raw_ostream &mOut;
+  std::string mTag;
   std::string mPassName;
+  TransformationContext *mTfmCtx = nullptr;
+  unsigned mNumDiags = 0;
 };
 
 char FunctionPassPrinter::ID = 0;
@@ -177,6 +237,11 @@ FunctionPass *llvm::createFunctionPassPrinter(
   return new FunctionPassPrinter(PI, OS);
 }
 
+FunctionPass *llvm::createFunctionPassPrinter(
+    const PassInfo *PI, raw_ostream &OS, StringRef Tag) {
+  return new FunctionPassPrinter(PI, OS, Tag);
+}
+
 ModulePass *llvm::createModulePassPrinter(const PassInfo *PI, raw_ostream &OS) {
   return new ModulePassPrinter(PI, OS);
 }
@@ -33,12 +33,14 @@
 #endif
 #include "tsar/Core/Query.h"
 #include "tsar/Core/TransformationContext.h"
+#include "tsar/Support/AnalysisCache.h"
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/PassBarrier.h"
 #include "tsar/Transform/Clang/Passes.h"
 #include "tsar/Transform/IR/Passes.h"
 #include "tsar/Transform/Mixed/Passes.h"
 #include <clang/Frontend/CompilerInstance.h>
+#include <llvm/ADT/ScopeExit.h>
 #include <llvm/Analysis/BasicAliasAnalysis.h>
 #include <llvm/Analysis/CFLAndersAliasAnalysis.h>
 #include <llvm/Analysis/CFLSteensAliasAnalysis.h>
@@ -49,6 +51,8 @@
 #include <llvm/Analysis/TypeBasedAliasAnalysis.h>
 #include <llvm/CodeGen/Passes.h>
 #include <llvm/IR/DebugInfo.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticPrinter.h>
 #include <llvm/IR/IRPrintingPasses.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Verifier.h>
@@ -64,6 +68,31 @@ using namespace clang;
 using namespace llvm;
 using namespace tsar;
 
+namespace {
+/// Prints LLVM diagnostics to a specified stream in the same way as
+/// LLVMContext prints them to the standard error stream by default.
+///
+/// Errors are not handled, so LLVMContext reports them and terminates
+/// the process.
+class StreamDiagnosticHandler : public DiagnosticHandler {
+public:
+  explicit StreamDiagnosticHandler(raw_ostream &OS) : mOS(OS) {}
+
+  bool handleDiagnostics(const DiagnosticInfo &DI) override {
+    if (DI.getSeverity() == DS_Error)
+      return false;
+    DiagnosticPrinterRawOStream DP(mOS);
+    mOS << LLVMContext::getDiagnosticMessagePrefix(DI.getSeverity()) << ": ";
+    DI.print(DP);
+    mOS << "\n";
+    return true;
+  }
+
+private:
+  raw_ostream &mOS;
+};
+}
+
 namespace tsar {
 void addImmutableAliasAnalysis(legacy::PassManager &Passes) {
   Passes.add(createCFLSteensAAWrapperPass());
@@ -102,10 +131,14 @@ void addInitialTransformations(legacy::PassManager &Passes) {
   Passes.add(createDINodeRetrieverPass());
 }
 
-void addBeforeTfmAnalysis(legacy::PassManager &Passes, StringRef AnalysisUse) {
+void addBeforeTfmAnalysis(legacy::PassManager &Passes, StringRef AnalysisUse,
+                          ArrayRef<std::string> CacheTags) {
   Passes.add(createCallExtractorPass());
   Passes.add(createGlobalDefinedMemoryPass());
   Passes.add(createGlobalLiveMemoryPass());
+  // Fingerprints of functions depend on results of interprocedural analysis.
+  if (!CacheTags.empty())
+    Passes.add(createFunctionFingerprintPass(CacheTags));
   Passes.add(createFunctionMemoryAttrsAnalysis());
   Passes.add(createDIDependencyAnalysisPass());
   Passes.add(createProcessDIMemoryTraitPass(mark<trait::DirectAccess>));
@@ -163,6 +196,10 @@ void addAfterLoopRotateAnalysis(legacy::PassManager &Passes) {
 }
 } // namespace tsar
 
+raw_ostream & DefaultQueryManager::getOutputStream() const {
+  return mOutput ? *mOutput : errs();
+}
+
 void DefaultQueryManager::addWithPrint(llvm::Pass *P, bool PrintResult,
     llvm::legacy::PassManager &Passes) {
   assert(P->getPotentialPassManagerType() == PMT_FunctionPassManager &&
@@ -174,7 +211,7 @@ void DefaultQueryManager::addWithPrint(llvm::Pass *P, bool PrintResult,
   if (PrintResult) {
     auto PI = PassRegistry::getPassRegistry()->getPassInfo(P->getPassID());
     Passes.add(P);
-    Passes.add(createFunctionPassPrinter(PI, errs()));
+    Passes.add(createFunctionPassPrinter(PI, getOutputStream()));
     return;
   }
   Passes.add(P);
@@ -182,6 +219,55 @@ void DefaultQueryManager::addWithPrint(llvm::Pass *P, bool PrintResult,
 
 void DefaultQueryManager::run(llvm::Module *M, TransformationContext *Ctx) {
   assert(M && "Module must not be null!");
+  // If results are redirected (for example, a source is analyzed concurrently
+  // with other sources), redirect LLVM diagnostics to the same stream, so
+  // they are not interleaved with output for other sources.
+  std::unique_ptr<DiagnosticHandler> DiagHandlerStash;
+  if (mOutput) {
+    DiagHandlerStash = M->getContext().getDiagHandler();
+    M->getContext().setDiagnosticHandler(
+      std::make_unique<StreamDiagnosticHandler>(*mOutput), true);
+  }
+  auto RestoreDiagHandler = make_scope_exit([this, M, &DiagHandlerStash]() {
+    if (mOutput)
+      M->getContext().setDiagnosticHandler(std::move(DiagHandlerStash));
+  });
+  // Only results of print passes can be reused, output passes may produce
+  // some other results (for example, files) which are not tracked.
+  if (mUseServer || !mOutputPasses.empty() || !mGlobalOptions ||
+      mGlobalOptions->AnalysisCache.empty()) {
+    runPasses(M, Ctx);
+    return;
+  }
+  AnalysisCache Cache(mGlobalOptions->AnalysisCache);
+  std::vector<std::string> Config;
+  for (auto *PI : mPrintPasses)
+    Config.push_back(PI->getPassArgument().str());
+  Config.push_back(std::to_string(mPrintSteps));
+  auto Key = AnalysisCache::computeKey(*M, *mGlobalOptions, Config);
+  if (auto Results = Cache.lookup(Key)) {
+    getOutputStream() << *Results;
+    return;
+  }
+  std::string Results;
+  raw_string_ostream OS(Results);
+  auto *OutputStash = mOutput;
+  mOutput = &OS;
+  auto NumDiags = Ctx ? Ctx->getNumReportedDiagnostics() : 0;
+  runPasses(M, Ctx);
+  mOutput = OutputStash;
+  OS.flush();
+  // Diagnostics are not stored in the cache, so results accompanied by
+  // diagnostics must not be reused, otherwise diagnostics will be lost.
+  bool HasDiags = Ctx && Ctx->getNumReportedDiagnostics() != NumDiags;
+  if (!HasDiags && !Cache.store(Key, Results))
+    getOutputStream() << "warning: unable to store results of analysis in '"
+           << Cache.getDirectory() << "'\n";
+  getOutputStream() << Results;
+}
+
+void DefaultQueryManager::runPasses(llvm::Module *M,
+    TransformationContext *Ctx) {
   legacy::PassManager Passes;
   Passes.add(createGlobalOptionsImmutableWrapper(mGlobalOptions));
   if (Ctx) {
@@ -193,12 +279,42 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationContext *Ctx) {
   }
   addImmutableAliasAnalysis(Passes);
   addInitialTransformations(Passes);
-  auto addPrint = [&Passes, this](ProcessingStep CurrentStep) {
+  // Results of function passes are cached for each function separately, so
+  // some functions may be skipped if they have not been changed. This is
+  // possible only if results of all printed passes are function-level ones,
+  // because other results (for example, results of output passes) may
+  // depend on analysis of the skipped functions.
+  auto getCacheTag = [](ProcessingStep Step, const PassInfo &PI) {
+    return (Twine(static_cast<unsigned>(Step)) + ":" + PI.getPassArgument())
+        .str();
+  };
+  std::vector<std::string> CacheTags;
+  bool IsIncremental = !mUseServer && mOutputPasses.empty() &&
+                       mGlobalOptions &&
+                       mGlobalOptions->IncrementalAnalysis &&
+                       !mGlobalOptions->AnalysisCache.empty();
+  for (auto Step : {BeforeTfmAnalysis, AfterSroaAnalysis,
+                    AfterLoopRotateAnalysis}) {
+    if (!IsIncremental || !(Step & mPrintSteps))
+      continue;
+    for (auto *PI : mPrintPasses) {
+      if (!PI->getNormalCtor())
+        continue;
+      auto *P = PI->getNormalCtor()();
+      IsIncremental &= P->getPassKind() == PT_Function;
+      delete P;
+      CacheTags.push_back(getCacheTag(Step, *PI));
+    }
+  }
+  IsIncremental &= !CacheTags.empty();
+  auto addPrint = [&Passes, &getCacheTag, IsIncremental,
+                   this](ProcessingStep CurrentStep) {
     if (!(CurrentStep & mPrintSteps))
       return;
     for (auto PI : mPrintPasses) {
       if (!PI->getNormalCtor()) {
-        errs() << "warning: cannot create pass: " << PI->getPassName() << "\n";
+        getOutputStream() << "warning: cannot create pass: "
+                          << PI->getPassName() << "\n";
         continue;
       }
       if (auto *GI = PrintPassGroup::getPassRegistry().groupInfo(*PI))
@@ -211,10 +327,14 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationContext *Ctx) {
         llvm_unreachable("Printers does not support this kind of passes yet!");
         break;
       case PT_Function:
-        Passes.add(createFunctionPassPrinter(PI, errs()));
+        if (IsIncremental)
+          Passes.add(createFunctionPassPrinter(PI, getOutputStream(),
+                                               getCacheTag(CurrentStep, *PI)));
+        else
+          Passes.add(createFunctionPassPrinter(PI, getOutputStream()));
         break;
       case PT_Module:
-        Passes.add(createModulePassPrinter(PI, errs()));
+        Passes.add(createModulePassPrinter(PI, getOutputStream()));
         break;
       }
     }
@@ -224,7 +344,8 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationContext *Ctx) {
       return;
     for (auto PI : mOutputPasses) {
       if (!PI->getNormalCtor()) {
-        errs() << "warning: cannot create pass: " << PI->getPassName() << "\n";
+        getOutputStream() << "warning: cannot create pass: "
+                          << PI->getPassName() << "\n";
         continue;
       }
       if (auto *GI = OutputPassGroup::getPassRegistry().groupInfo(*PI))
@@ -265,6 +386,9 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationContext *Ctx) {
   }
   Passes.add(createMemoryMatcherPass());
   Passes.add(createGlobalDefinedMemoryStorage());
+  // Def-use sets of basic blocks which have not been changed between
+  // analysis steps are reused.
+  Passes.add(createDefUseSummaryCacheStorage());
   Passes.add(createGlobalLiveMemoryStorage());
   // It is necessary to destroy DIMemoryTraitPool before DIMemoryEnvironment to
   // avoid dangling handles. So, we add pool before environment in the manager.
@@ -275,25 +399,41 @@ void DefaultQueryManager::run(llvm::Module *M, TransformationContext *Ctx) {
   addIfNecessary(createAPCLoopInfoBasePass(), mPrintPasses,
                  PrintPassGroup::getPassRegistry(), Passes);
 #endif
-  addBeforeTfmAnalysis(Passes);
+  addBeforeTfmAnalysis(Passes, "",
+                       IsIncremental ? CacheTags : ArrayRef<std::string>());
   addPrint(BeforeTfmAnalysis);
   addOutput(BeforeTfmAnalysis);
-  addAfterSROAAnalysis(*mGlobalOptions, M->getDataLayout(), Passes);
+  if (isStepNecessary(AfterSroaAnalysis)) {
+    addAfterSROAAnalysis(*mGlobalOptions, M->getDataLayout(), Passes);
 #ifdef APC_FOUND
-  addIfNecessary(createAPCFunctionInfoPass(), mPrintPasses,
-                 PrintPassGroup::getPassRegistry(), Passes);
-  addIfNecessary(createAPCArrayInfoPass(), mPrintPasses,
-                 PrintPassGroup::getPassRegistry(), Passes);
+    addIfNecessary(createAPCFunctionInfoPass(), mPrintPasses,
+                   PrintPassGroup::getPassRegistry(), Passes);
+    addIfNecessary(createAPCArrayInfoPass(), mPrintPasses,
+                   PrintPassGroup::getPassRegistry(), Passes);
 #endif
-  addPrint(AfterSroaAnalysis);
-  addOutput(AfterSroaAnalysis);
-  addAfterLoopRotateAnalysis(Passes);
-  addPrint(AfterLoopRotateAnalysis);
-  addOutput(AfterLoopRotateAnalysis);
+    addPrint(AfterSroaAnalysis);
+    addOutput(AfterSroaAnalysis);
+  }
+  if (isStepNecessary(AfterLoopRotateAnalysis)) {
+    addAfterLoopRotateAnalysis(Passes);
+    addPrint(AfterLoopRotateAnalysis);
+    addOutput(AfterLoopRotateAnalysis);
+  }
   Passes.add(createVerifierPass());
   Passes.run(*M);
 }
 
+bool DefaultQueryManager::isStepNecessary(ProcessingStep Step) const {
+  // If nothing should be printed all steps are performed because analysis
+  // passes may emit diagnostics.
+  if (mPrintPasses.empty() && mOutputPasses.empty())
+    return true;
+  // Each step depends on the previous ones only, so the step is necessary if
+  // it or some of the following steps is requested.
+  using StepT = std::underlying_type<ProcessingStep>::type;
+  return static_cast<StepT>(mPrintSteps) >= static_cast<StepT>(Step);
+}
+
 bool EmitLLVMQueryManager::beginSourceFile(
     CompilerInstance &CI, StringRef InFile) {
   mOS = CI.createDefaultOutputFile(false, InFile, "ll");
@@ -32,18 +32,23 @@
 #include "tsar/Frontend/Clang/ASTMergeAction.h"
 #include "tsar/Frontend/Clang/Pragma.h"
 #include "tsar/Support/GlobalOptions.h"
+#include "tsar/Support/PassProfile.h"
 #ifdef APC_FOUND
 # include "tsar/APC/Utils.h"
 #endif
 #include <clang/Frontend/FrontendActions.h>
+#include <clang/Frontend/TextDiagnosticPrinter.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/ScopeExit.h>
 #include <llvm/IR/LegacyPassNameParser.h>
 #include <llvm/Support/Debug.h>
 #include <llvm/Support/Path.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/VirtualFileSystem.h>
 #ifdef lp_solve_FOUND
 # include <lp_solve/lp_solve_config.h>
 #endif
@@ -131,13 +136,19 @@ struct Options : private bcl::Uncopyable {
   llvm::cl::opt<bool> NoShowSourceLocation;
   llvm::cl::opt<std::string> BuildPath;
   llvm::cl::alias BuildPathA;
+  llvm::cl::opt<unsigned> Jobs;
+  llvm::cl::opt<bool> Batch;
 
   llvm::cl::OptionCategory DebugCategory;
   llvm::cl::opt<bool> EmitLLVM;
   llvm::cl::opt<bool> PrintAST;
   llvm::cl::opt<bool> DumpAST;
   llvm::cl::opt<bool> TimeReport;
+  llvm::cl::opt<std::string> ProfileJSON;
   llvm::cl::opt<bool> UseServer;
+  llvm::cl::opt<bool> DataFlowWorklist;
+  llvm::cl::opt<bool> NoLocationNumbering;
+  llvm::cl::opt<bool> NoLiveMemoryBits;
 
   llvm::cl::opt<bool> PrintAll;
   llvm::cl::list<const PassInfo *, bool,
@@ -165,6 +176,11 @@ struct Options : private bcl::Uncopyable {
   llvm::cl::opt<bool> NoMathErrno;
   llvm::cl::opt<std::string> AnalysisUse;
   llvm::cl::list<std::string> OptRegion;
+  llvm::cl::opt<std::string> AnalysisCache;
+  llvm::cl::opt<bool> IncrementalAnalysis;
+  llvm::cl::opt<unsigned> DataFlowThreads;
+  llvm::cl::opt<bool> SparseReachDefinitions;
+  llvm::cl::opt<unsigned> AnswerCacheLimit;
 
   llvm::cl::OptionCategory TransformCategory;
   llvm::cl::opt<bool> NoFormat;
@@ -180,7 +196,7 @@ private:
 
 Options::Options() :
   Sources(cl::Positional, cl::desc("<source0> [... <sourceN>]"),
-    cl::OneOrMore),
+    cl::ZeroOrMore),
   TfmPass(cl::desc("Transformations available (one at a time):")),
   OutputPasses(cl::desc("Analysis available:")),
   CompileCategory("Compilation options"),
@@ -220,6 +236,11 @@ Options::Options() :
   BuildPath("build-path", cl::desc("Starting point to look up for compilation database in upward direction"),
     cl::cat(CompileCategory)),
   BuildPathA("p", cl::aliasopt(BuildPath), cl::desc("Alias for -build-path")),
+  Jobs("j", cl::cat(CompileCategory), cl::value_desc("N"), cl::init(1),
+    cl::desc("Analyze up to N translation units concurrently (0 means the number of hardware threads)"),
+    cl::Prefix),
+  Batch("batch", cl::cat(CompileCategory),
+    cl::desc("Analyze all sources from a compilation database in a single process (the database is searched in the current directory if -p is not set)")),
   DebugCategory("Debugging options"),
   EmitLLVM("emit-llvm", cl::cat(DebugCategory),
     cl::desc("Emit llvm without analysis")),
@@ -229,8 +250,16 @@ Options::Options() :
     cl::desc("Build ASTs and then debug dump them")),
   TimeReport("ftime-report", cl::cat(DebugCategory),
     cl::desc("Print some statistics about the time consumed by each pass when it finishes")),
+  ProfileJSON("profile-json", cl::cat(DebugCategory), cl::value_desc("file"),
+    cl::desc("Write time and memory consumed by each pass for each function to <file> (trace-event profile is written to <file>.trace.json)")),
   UseServer("use-analysis-server", cl::cat(DebugCategory),
     cl::desc("Run default workflow on analysis server")),
+  DataFlowWorklist("data-flow-worklist", cl::cat(DebugCategory),
+    cl::desc("Solve data-flow problems with a worklist for acyclic graphs too")),
+  NoLocationNumbering("no-location-numbering", cl::cat(DebugCategory),
+    cl::desc("Store reach definitions in range-based sets instead of bit vectors")),
+  NoLiveMemoryBits("no-live-memory-bits", cl::cat(DebugCategory),
+    cl::desc("Do not use bit vectors to solve live memory problems")),
   PrintAll("print-all", cl::cat(DebugCategory),
     cl::desc("Print all available results")),
   PrintOnly("print-only", cl::cat(DebugCategory), cl::CommaSeparated,
@@ -276,6 +305,19 @@ Options::Options() :
   OptRegion("foptimize-only", cl::cat(AnalysisCategory), cl::value_desc("regions"),
     cl::ZeroOrMore, cl::ValueRequired, cl::CommaSeparated,
     cl::desc("Allow optimization of specified regions (comma separated list of region names")),
+  AnalysisCache("fanalysis-cache", cl::cat(AnalysisCategory),
+    cl::value_desc("directory"),
+    cl::desc("Reuse results of analysis stored in a directory for unchanged translation units")),
+  IncrementalAnalysis("fincremental-analysis", cl::cat(AnalysisCategory),
+    cl::desc("Reuse cached results of analysis for unchanged functions (requires -fanalysis-cache)")),
+  DataFlowThreads("fdata-flow-threads", cl::cat(AnalysisCategory),
+    cl::value_desc("N"), cl::init(0),
+    cl::desc("Solve data-flow problems for sibling loops on N threads (0 - sequentially, default)")),
+  SparseReachDefinitions("fsparse-reach-def", cl::cat(AnalysisCategory),
+    cl::desc("Use sparse def-use chains over alias nodes to find reach definitions")),
+  AnswerCacheLimit("fanswer-cache-limit", cl::cat(AnalysisCategory),
+    cl::value_desc("megabytes"), cl::init(64),
+    cl::desc("Limit memory occupied by answers cached in the analysis server (0 - unlimited, default 64)")),
   TransformCategory("Transformation options"),
   NoFormat("no-format", cl::cat(TransformCategory),
     cl::desc("Disable format of transformed sources")),
@@ -365,6 +407,55 @@ static std::vector<const char *> addInternalArgs(int Argc, const char **Argv) {
   return Args;
 }
 
+/// Runs a specified action for each source on a pool of `Jobs` workers.
+///
+/// Each worker owns a separate ClangTool which processes a single source.
+/// ClangTool sets working directory of its file system to the directory of
+/// a compile command, so each worker also uses a separate physical file system
+/// instead of the real one which shares working directory of the process.
+/// This file system is passed to `Action`.
+/// Diagnostics and other output produced for a source are collected separately
+/// and are printed to the standard error stream in order of sources after all
+/// workers have finished.
+/// \return Zero if all actions succeed.
+static int runOnEachSource(unsigned Jobs,
+    const CompilationDatabase &Compilations, ArrayRef<std::string> CommandLine,
+    ArrayRef<std::string> Sources,
+    function_ref<int(ClangTool &, vfs::FileSystem &, raw_ostream &, unsigned)>
+      Action) {
+  struct Job {
+    std::string Output;
+    int Result = 0;
+  };
+  std::vector<Job> Results(Sources.size());
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts(new DiagnosticOptions);
+  DiagOpts->ShowCarets = !is_contained(CommandLine, "-fno-caret-diagnostics");
+  DiagOpts->ShowLocation =
+      !is_contained(CommandLine, "-fno-show-source-location");
+  ThreadPool Pool(hardware_concurrency(Jobs));
+  for (unsigned SrcIdx = 0, SrcIdxE = Sources.size(); SrcIdx < SrcIdxE;
+       ++SrcIdx)
+    Pool.async([SrcIdx, &Results, &Sources, &Compilations, &DiagOpts,
+                &Action]() {
+      raw_string_ostream OS(Results[SrcIdx].Output);
+      TextDiagnosticPrinter DiagPrinter(OS, DiagOpts.get());
+      IntrusiveRefCntPtr<vfs::FileSystem> FS(
+        vfs::createPhysicalFileSystem().release());
+      ClangTool CTool(Compilations, Sources[SrcIdx],
+        std::make_shared<PCHContainerOperations>(), FS);
+      CTool.setDiagnosticConsumer(&DiagPrinter);
+      Results[SrcIdx].Result = Action(CTool, *FS, OS, SrcIdx);
+      OS.flush();
+    });
+  Pool.wait();
+  int Result = 0;
+  for (auto &J : Results) {
+    errs() << J.Output;
+    Result |= J.Result;
+  }
+  return Result ? 1 : 0;
+}
+
 Tool::Tool(int Argc, const char **Argv) {
   assert(Argv && "List of command line arguments must not be null!");
   Options::get(); // At first, initialize command line options.
@@ -489,11 +580,13 @@ void Tool::storeCLOptions() {
     mCommandLine.emplace_back("-fmath-errno");
   if (Options::get().NoMathErrno)
     mCommandLine.emplace_back("-fno-math-errno");
-  if (!Options::get().BuildPath.empty()) {
+  StringRef BuildPath = Options::get().BuildPath;
+  if (BuildPath.empty() && Options::get().Batch)
+    BuildPath = ".";
+  if (!BuildPath.empty()) {
     std::string ErrorMessage;
     mCompilations =
-        CompilationDatabase::autoDetectFromDirectory(
-          Options::get().BuildPath, ErrorMessage);
+        CompilationDatabase::autoDetectFromDirectory(BuildPath, ErrorMessage);
     if (!mCompilations && !ErrorMessage.empty()) {
       ErrorMessage.append("\n");
       llvm::errs() << "Error while trying to load a compilation database:\n"
@@ -514,6 +607,19 @@ void Tool::storeCLOptions() {
     mCompilations = std::unique_ptr<CompilationDatabase>(
       new FixedCompilationDatabase(".", mCommandLine));
   }
+  // In batch mode all sources from a compilation database are analyzed if
+  // sources are not specified explicitly. Sources are sorted to obtain
+  // reproducible order of results.
+  if (Options::get().Batch && mSources.empty()) {
+    mSources = mCompilations->getAllFiles();
+    llvm::sort(mSources);
+  }
+  if (mSources.empty()) {
+    Options::get().Sources.error(Options::get().Batch ?
+      "error - compilation database does not contain any sources" :
+      "error - no input files");
+    exit(1);
+  }
   OptionList IncompatibleOpts;
   auto addIfSet = [&IncompatibleOpts](cl::opt<bool> &O) -> cl::opt<bool> & {
     if (O)
@@ -584,6 +690,20 @@ void Tool::storeCLOptions() {
   }
   mGlobalOpts.OptRegions = Options::get().OptRegion;
   mGlobalOpts.AnalysisUse = Options::get().AnalysisUse;
+  mGlobalOpts.AnalysisCache = Options::get().AnalysisCache;
+  mGlobalOpts.IncrementalAnalysis = Options::get().IncrementalAnalysis;
+  mGlobalOpts.DataFlowThreads = Options::get().DataFlowThreads;
+  mGlobalOpts.SparseReachDefinitions = Options::get().SparseReachDefinitions;
+  mGlobalOpts.DataFlowWorklist = Options::get().DataFlowWorklist;
+  mGlobalOpts.NoLocationNumbering = Options::get().NoLocationNumbering;
+  mGlobalOpts.NoLiveMemoryBits = Options::get().NoLiveMemoryBits;
+  mGlobalOpts.AnswerCacheLimit = Options::get().AnswerCacheLimit;
+  if (mGlobalOpts.IncrementalAnalysis && mGlobalOpts.AnalysisCache.empty())
+    errs() << "WARNING: The -fincremental-analysis option is ignored when "
+              "-fanalysis-cache is not set.\n";
+  mProfileFilename = Options::get().ProfileJSON;
+  if (!mProfileFilename.empty())
+    PassProfiler::get().enable();
   mEmitAST = addLLIfSet(addIfSet(Options::get().EmitAST));
   mMergeAST = mEmitAST ?
     addLLIfSet(addIfSet(Options::get().MergeAST)) :
@@ -607,6 +727,15 @@ void Tool::storeCLOptions() {
   bool NoTfmPass = !mTfmPass && !mInstrLLVM && !mEmitLLVM;
   mServer =
       addIfSetIf(Options::get().UseServer, !mPrint && (!NoTfmPass || mCheck));
+  mJobs = Options::get().Jobs;
+  if (mJobs != 1 && !mMergeAST && !mEmitAST &&
+      (!NoTfmPass || mCheck || mServer))
+    errs() << "WARNING: The -j option is ignored when translation units can "
+              "not be analyzed independently.\n";
+  if (!mGlobalOpts.AnalysisCache.empty() &&
+      (!NoTfmPass || mCheck || mServer || !mOutputPasses.empty()))
+    errs() << "WARNING: The -fanalysis-cache option is ignored when "
+              "results of analysis are not printed.\n";
   if (!Options::get().PrintStep.empty() && mServer) {
     std::string Msg("error - this option is incompatible with");
     Msg.append(" -").append(Options::get().PrintStep.ArgStr.data());
@@ -643,6 +772,15 @@ void Tool::storeCLOptions() {
 }
 
 int Tool::run(QueryManager *QM) {
+  auto WriteProfile = make_scope_exit([this]() {
+    if (!mProfileFilename.empty() &&
+        !PassProfiler::get().write(mProfileFilename))
+      errs() << "WARNING: unable to write profile to '" << mProfileFilename
+             << "'\n";
+  });
+  // Sources which are analyzed sequentially share the same file manager, so
+  // headers which are included in multiple sources are looked up only once.
+  mFiles = new FileManager(FileSystemOptions(), vfs::getRealFileSystem());
   std::vector<std::string> NoASTSources;
   std::vector<std::string> SourcesToMerge;
   std::vector<std::string> LLSources;
@@ -660,56 +798,90 @@ int Tool::run(QueryManager *QM) {
     else
       SourcesToMerge.push_back(Src);
   }
-  // Evaluation of Clang AST files by this tool leads an error,
-  // so these sources should be excluded.
-  ClangTool EmitPCHTool(*mCompilations, NoASTSources);
-  auto ArgumentsAdjuster = [&SourcesToMerge, this](
-    const CommandLineArguments &CL, StringRef Filename) {
-    CommandLineArguments Adjusted;
-    for (std::size_t I = 0; I < CL.size(); ++I) {
-      StringRef Arg = CL[I];
-      // If `-fsyntax-only` is set all output files will be ignored.
-      if (Arg.startswith("-fsyntax-only"))
-        Adjusted.emplace_back("-emit-ast");
-      else
-        Adjusted.push_back(Arg.str());
-    }
-    Adjusted.emplace_back("-o");
-    if (mOutputFilename.empty()) {
-      SmallString<128> PCHFile = Filename;
-      sys::path::replace_extension(PCHFile, ".ast");
+  // Names of output files are made absolute according to the working
+  // directory of a specified file system. ClangTool sets it to the directory
+  // of a compile command before arguments are adjusted, so names are resolved
+  // in the same way if sources are processed sequentially (the real file
+  // system is used) and concurrently (each source has its own file system).
+  auto getEmitPCHAdjuster = [this](std::vector<std::string> &PCHFiles,
+                                   vfs::FileSystem &FS) {
+    return [&PCHFiles, &FS, this](
+        const CommandLineArguments &CL, StringRef Filename) {
+      CommandLineArguments Adjusted;
+      for (std::size_t I = 0; I < CL.size(); ++I) {
+        StringRef Arg = CL[I];
+        // If `-fsyntax-only` is set all output files will be ignored.
+        if (Arg.startswith("-fsyntax-only"))
+          Adjusted.emplace_back("-emit-ast");
+        else
+          Adjusted.push_back(Arg.str());
+      }
+      Adjusted.emplace_back("-o");
+      SmallString<128> PCHFile;
+      if (mOutputFilename.empty()) {
+        PCHFile = Filename;
+        sys::path::replace_extension(PCHFile, ".ast");
+      } else {
+        PCHFile = mOutputFilename;
+      }
+      FS.makeAbsolute(PCHFile);
       Adjusted.push_back(std::string(PCHFile));
-      SourcesToMerge.push_back(std::string(PCHFile));
-    } else {
-      Adjusted.push_back(mOutputFilename);
-      SourcesToMerge.push_back(mOutputFilename);
+      PCHFiles.push_back(std::string(PCHFile));
+      return Adjusted;
+    };
+  };
+  // Emit Clang AST files for source inputs and append names of these files
+  // to the `PCHFiles` collection. Evaluation of Clang AST files by this tool
+  // leads an error, so these sources should be excluded. Note, that names of
+  // emitted files are appended in order of sources even if sources are
+  // processed concurrently, so the result of merge is reproducible.
+  auto emitPCH = [this, &NoASTSources, &getEmitPCHAdjuster](
+      std::vector<std::string> &PCHFiles) {
+    if (mJobs == 1 || NoASTSources.size() < 2) {
+      auto RealFS = vfs::getRealFileSystem();
+      ClangTool EmitPCHTool(*mCompilations, NoASTSources,
+        std::make_shared<PCHContainerOperations>(), RealFS, mFiles);
+      EmitPCHTool.appendArgumentsAdjuster(
+        getEmitPCHAdjuster(PCHFiles, *RealFS));
+      return EmitPCHTool.run(newFrontendActionFactory<
+        GeneratePCHAction, GenPCHPragmaAction>().get());
     }
-    return Adjusted;
+    std::vector<std::vector<std::string>> PCHFilesPerSource(
+      NoASTSources.size());
+    auto Result = runOnEachSource(mJobs, *mCompilations, mCommandLine,
+      NoASTSources, [&PCHFilesPerSource, &getEmitPCHAdjuster](
+          ClangTool &EmitPCHTool, vfs::FileSystem &FS, raw_ostream &,
+          unsigned SrcIdx) {
+        EmitPCHTool.appendArgumentsAdjuster(
+          getEmitPCHAdjuster(PCHFilesPerSource[SrcIdx], FS));
+        return EmitPCHTool.run(newFrontendActionFactory<
+          GeneratePCHAction, GenPCHPragmaAction>().get());
+      });
+    for (auto &Files : PCHFilesPerSource)
+      PCHFiles.insert(PCHFiles.end(), Files.begin(), Files.end());
+    return Result;
   };
-  EmitPCHTool.appendArgumentsAdjuster(ArgumentsAdjuster);
   if (mEmitAST) {
     if (!mOutputFilename.empty() && NoASTSources.size() > 1) {
       errs() << "WARNING: The -o (output filename) option is ignored when "
                 "generating multiple output files.\n";
       mOutputFilename.clear();
     }
-    return EmitPCHTool.run(
-      newFrontendActionFactory<GeneratePCHAction, GenPCHPragmaAction>().get());
+    return emitPCH(SourcesToMerge);
   }
   if (!mOutputFilename.empty())
     errs() << "WARNING: The -o (output filename) option is ignored when "
               "the -emit-ast option is not used.\n";
   // Name of output should be unset to ignore this option when argument adjuster
-  // for EmitPCHTool will be invoked.
+  // for emission of Clang AST files will be invoked.
   mOutputFilename.clear();
   // Emit Clang AST files for source inputs if inputs should be merged before
   // analysis. AST files will be stored in SourcesToMerge collection.
   // If an input file already contains Clang AST it will be pushed into
   // the SourcesToMerge collection only.
-  if (mMergeAST) {
-    EmitPCHTool.run(
-      newFrontendActionFactory<GeneratePCHAction, GenPCHPragmaAction>().get());
-  }
+  if (mMergeAST)
+    emitPCH(SourcesToMerge);
+  bool IsDefaultQM = !QM && !mEmitLLVM && !mInstrLLVM && !mTfmPass && !mCheck;
   if (!QM) {
     if (mEmitLLVM)
       QM = getEmitLLVMQM();
@@ -725,7 +897,9 @@ int Tool::run(QueryManager *QM) {
   }
   auto ImportInfoStorage = QM->initializeImportInfo();
   if (mMergeAST) {
-    ClangTool CTool(*mCompilations, SourcesToMerge.back());
+    ClangTool CTool(*mCompilations, SourcesToMerge.back(),
+      std::make_shared<PCHContainerOperations>(), vfs::getRealFileSystem(),
+      mFiles);
     SourcesToMerge.pop_back();
     if (mDumpAST)
       return CTool.run(newFrontendActionFactory<
@@ -741,7 +915,12 @@ int Tool::run(QueryManager *QM) {
       newAnalysisActionFactory<MainAction, ASTMergeActionWithInfo>(
       mCommandLine, QM, SourcesToMerge, ImportInfoStorage).get());
   }
-  ClangTool CTool(*mCompilations, NoLLSources);
+  if (IsDefaultQM && !mServer && !mDumpAST && !mPrintAST && mJobs != 1 &&
+      NoLLSources.size() + LLSources.size() > 1)
+    return runConcurrently(NoLLSources, LLSources);
+  ClangTool CTool(*mCompilations, NoLLSources,
+    std::make_shared<PCHContainerOperations>(), vfs::getRealFileSystem(),
+    mFiles);
   if (mDumpAST)
     return CTool.run(newFrontendActionFactory<
       tsar::ASTDumpAction, tsar::GenPCHPragmaAction>().get());
@@ -749,10 +928,31 @@ int Tool::run(QueryManager *QM) {
     return CTool.run(newFrontendActionFactory<
       tsar::ASTPrintAction, tsar::GenPCHPragmaAction>().get());
   // Do not search pragmas in .ll file to avoid internal assertion fails.
-  ClangTool CLLTool(*mCompilations, LLSources);
+  ClangTool CLLTool(*mCompilations, LLSources,
+    std::make_shared<PCHContainerOperations>(), vfs::getRealFileSystem(),
+    mFiles);
   return
     CTool.run(newAnalysisActionFactory<MainAction, GenPCHPragmaAction>(
       mCommandLine, QM).get()) ||
     CLLTool.run(newAnalysisActionFactory<MainAction>(mCommandLine, QM).get()) ?
     1 : 0;
 }
+
+int Tool::runConcurrently(ArrayRef<std::string> Sources,
+    ArrayRef<std::string> LLSources) {
+  std::vector<std::string> AllSources(Sources.begin(), Sources.end());
+  AllSources.insert(AllSources.end(), LLSources.begin(), LLSources.end());
+  return runOnEachSource(mJobs, *mCompilations, mCommandLine, AllSources,
+    [this, &Sources](ClangTool &CTool, vfs::FileSystem &, raw_ostream &OS,
+        unsigned SrcIdx) {
+      DefaultQueryManager QM(false, &mGlobalOpts, mOutputPasses, mPrintPasses,
+        (DefaultQueryManager::ProcessingStep)mPrintSteps);
+      QM.setOutputStream(OS);
+      // Do not search pragmas in .ll file to avoid internal assertion fails.
+      return SrcIdx >= Sources.size() ?
+        CTool.run(newAnalysisActionFactory<MainAction>(
+          mCommandLine, &QM).get()) :
+        CTool.run(newAnalysisActionFactory<MainAction, GenPCHPragmaAction>(
+          mCommandLine, &QM).get());
+    });
+}
@@ -0,0 +1,128 @@
+//===--- AnalysisCache.cpp -- Persistent Analysis Results -------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a content-addressed on-disk storage of analysis results.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Support/AnalysisCache.h"
+#include "tsar/Core/tsar-config.h"
+#include "tsar/Support/GlobalOptions.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Debug.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_sha1_ostream.h>
+
+using namespace llvm;
+using namespace tsar;
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "analysis-cache"
+
+/// Writes to a specified stream all options which influence analysis results.
+static void writeConfig(raw_ostream &OS, const GlobalOptions &GO,
+    ArrayRef<std::string> Config) {
+  OS << TSAR_VERSION_STRING << '\0';
+  OS << GO.PrintFilenameOnly << GO.IsSafeTypeCast << GO.InBoundsSubscripts
+     << GO.AnalyzeLibFunc << GO.IgnoreRedundantMemory << GO.UnsafeTfmAnalysis
+     << GO.NoExternalCalls << GO.IncrementalAnalysis
+     << GO.SparseReachDefinitions << '\0';
+  for (auto &Region : GO.OptRegions)
+    OS << Region << '\0';
+  OS << '\0';
+  // Results depend on the content of a file with external analysis results,
+  // not only on its name.
+  if (!GO.AnalysisUse.empty()) {
+    OS << GO.AnalysisUse << '\0';
+    if (auto Buffer = MemoryBuffer::getFile(GO.AnalysisUse))
+      OS << (*Buffer)->getBuffer();
+    OS << '\0';
+  }
+  for (auto &C : Config)
+    OS << C << '\0';
+  OS << '\0';
+}
+
+std::string AnalysisCache::computeKey(const Module &M, const GlobalOptions &GO,
+    ArrayRef<std::string> Config) {
+  raw_sha1_ostream OS;
+  writeConfig(OS, GO, Config);
+  M.print(OS, nullptr);
+  return toHex(OS.sha1(), true);
+}
+
+std::string AnalysisCache::computeKey(StringRef Fingerprint,
+    const GlobalOptions &GO, ArrayRef<std::string> Config) {
+  raw_sha1_ostream OS;
+  writeConfig(OS, GO, Config);
+  OS << Fingerprint;
+  return toHex(OS.sha1(), true);
+}
+
+Optional<std::string> AnalysisCache::lookup(StringRef Key) const {
+  SmallString<128> Path(mDir);
+  sys::path::append(Path, Key);
+  auto Buffer = MemoryBuffer::getFile(Path);
+  if (!Buffer) {
+    LLVM_DEBUG(dbgs() << "[ANALYSIS CACHE]: miss " << Key << "\n");
+    return None;
+  }
+  LLVM_DEBUG(dbgs() << "[ANALYSIS CACHE]: hit " << Key << "\n");
+  return (*Buffer)->getBuffer().str();
+}
+
+bool AnalysisCache::contains(StringRef Key) const {
+  SmallString<128> Path(mDir);
+  sys::path::append(Path, Key);
+  return sys::fs::exists(Path);
+}
+
+bool AnalysisCache::store(StringRef Key, StringRef Results) const {
+  if (sys::fs::create_directories(mDir))
+    return false;
+  // Write results to a temporary file at first and rename it then. This
+  // ensures that concurrent readers never observe partially written entries.
+  SmallString<128> TmpModel(mDir), TmpPath;
+  sys::path::append(TmpModel, Key + "-%%%%%%%%.tmp");
+  int FD;
+  if (sys::fs::createUniqueFile(TmpModel, FD, TmpPath))
+    return false;
+  {
+    raw_fd_ostream OS(FD, true);
+    OS << Results;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TmpPath);
+      return false;
+    }
+  }
+  SmallString<128> Path(mDir);
+  sys::path::append(Path, Key);
+  if (sys::fs::rename(TmpPath, Path)) {
+    sys::fs::remove(TmpPath);
+    return false;
+  }
+  return true;
+}
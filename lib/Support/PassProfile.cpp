@@ -0,0 +1,183 @@
+//===-- PassProfile.cpp --- Per-Pass Profile of Analysis --------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a profiler which records time and memory consumed by
+// each execution of a pass for each function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tsar/Support/PassProfile.h"
+#include "tsar/ADT/DataFlow.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Pass.h>
+#include <llvm/PassInfo.h>
+#include <llvm/PassRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cstdio>
+
+using namespace llvm;
+using namespace tsar;
+
+#undef DEBUG_TYPE
+#define DEBUG_TYPE "data-flow"
+
+STATISTIC(NumDFRegions, "Number of solved data-flow graphs");
+STATISTIC(NumDFIterations, "Number of sweeps over data-flow graphs");
+STATISTIC(MaxDFIterations, "Maximum number of sweeps over a data-flow graph");
+STATISTIC(NumDFTransfers, "Number of evaluated transfer functions");
+STATISTIC(NumDFChangedNodes, "Number of data-flow values which are changed");
+STATISTIC(MaxDFSetSize, "Maximum cardinality of a data-flow value");
+
+PassProfiler & PassProfiler::get() {
+  static PassProfiler Profiler;
+  return Profiler;
+}
+
+void PassProfiler::enable() {
+  mStart = std::chrono::steady_clock::now();
+  mIsEnabled = true;
+}
+
+std::uint64_t PassProfiler::now() const {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - mStart).count();
+}
+
+void PassProfiler::add(Record &&R) {
+  std::lock_guard<std::mutex> Lock(mMutex);
+  mRecords.push_back(std::move(R));
+}
+
+std::vector<PassProfiler::Record> PassProfiler::getRecords() const {
+  std::lock_guard<std::mutex> Lock(mMutex);
+  return mRecords;
+}
+
+static bool writeJSON(StringRef Filename, json::Value &&V) {
+  std::error_code EC;
+  raw_fd_ostream OS(Filename, EC, sys::fs::OF_Text);
+  if (EC)
+    return false;
+  OS << formatv("{0:2}", V) << "\n";
+  return !OS.has_error();
+}
+
+bool PassProfiler::write(StringRef Filename) const {
+  auto Records = getRecords();
+  json::Array Passes, Events;
+  auto PID = sys::Process::getProcessId();
+  for (auto &R : Records) {
+    json::Object Counters;
+    for (auto &C : R.Counters)
+      Counters[C.first] = C.second;
+    json::Object Args(Counters);
+    Args["function"] = R.Function;
+    Args["rss-delta"] = R.RSSDelta;
+    Passes.push_back(json::Object{
+      {"pass", R.Pass},
+      {"function", R.Function},
+      {"thread", static_cast<int64_t>(R.Thread)},
+      {"start-us", static_cast<int64_t>(R.Start)},
+      {"wall-us", static_cast<int64_t>(R.Duration)},
+      {"rss-delta", R.RSSDelta},
+      {"counters", std::move(Counters)}});
+    auto Name = R.Function.empty() ? R.Pass : R.Pass + " (" + R.Function + ")";
+    Events.push_back(json::Object{
+      {"name", std::move(Name)},
+      {"cat", "pass"},
+      {"ph", "X"},
+      {"ts", static_cast<int64_t>(R.Start)},
+      {"dur", static_cast<int64_t>(R.Duration)},
+      {"pid", static_cast<int64_t>(PID)},
+      {"tid", static_cast<int64_t>(R.Thread)},
+      {"args", std::move(Args)}});
+  }
+  SmallString<128> TraceFile(Filename);
+  TraceFile += ".trace.json";
+  bool Result =
+    writeJSON(Filename, json::Object{{"passes", std::move(Passes)}});
+  Result &= writeJSON(TraceFile, json::Object{
+    {"traceEvents", std::move(Events)}, {"displayTimeUnit", "ms"}});
+  return Result;
+}
+
+std::size_t tsar::getResidentSetSize() {
+#ifdef __linux__
+  // The second field in /proc/self/statm is a number of resident pages.
+  if (auto *File = std::fopen("/proc/self/statm", "r")) {
+    unsigned long long Size = 0, Resident = 0;
+    auto Count = std::fscanf(File, "%llu %llu", &Size, &Resident);
+    std::fclose(File);
+    if (Count == 2)
+      return Resident * sys::Process::getPageSizeEstimate();
+  }
+#endif
+  return sys::Process::GetMallocUsage();
+}
+
+PassProfileRegion::PassProfileRegion(const Pass &P, const Function *F)
+    : mIsActive(PassProfiler::get().isEnabled()) {
+  if (!mIsActive)
+    return;
+  if (auto *PI = PassRegistry::getPassRegistry()->getPassInfo(P.getPassID()))
+    mRecord.Pass = PI->getPassArgument().str();
+  else
+    mRecord.Pass = P.getPassName().str();
+  if (F)
+    mRecord.Function = F->getName().str();
+  mRecord.Thread = get_threadid();
+  mRSS = getResidentSetSize();
+  mRecord.Start = PassProfiler::get().now();
+}
+
+PassProfileRegion::~PassProfileRegion() {
+  if (!mIsActive)
+    return;
+  mRecord.Duration = PassProfiler::get().now() - mRecord.Start;
+  mRecord.RSSDelta = static_cast<std::int64_t>(getResidentSetSize()) -
+                     static_cast<std::int64_t>(mRSS);
+  PassProfiler::get().add(std::move(mRecord));
+}
+
+bool tsar::isDataFlowStatisticsRequested(const PassProfileRegion &Profile) {
+  // Convergence of data-flow solvers is investigated only if results can be
+  // accessed.
+  return Profile || AreStatisticsEnabled();
+}
+
+void tsar::reportDataFlowStatistics(const DataFlowStatistics &Stats,
+    PassProfileRegion &Profile) {
+  NumDFRegions += Stats.getNumRegions();
+  NumDFIterations += Stats.getIterations();
+  MaxDFIterations.updateMax(Stats.getMaxIterations());
+  NumDFTransfers += Stats.getTransferCalls();
+  NumDFChangedNodes += Stats.getChangedNodes();
+  MaxDFSetSize.updateMax(Stats.getMaxSetSize());
+  Stats.for_each_counter([&Profile](StringRef Name, std::size_t Value) {
+    Profile.addCounter(Name, Value);
+  });
+}
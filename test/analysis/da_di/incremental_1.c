@@ -0,0 +1,90 @@
+struct STy { int X; double Y; char Z[SIZE]; };
+
+double foo(int N) {
+  struct STy S;
+  double Res = 0;
+  S.Y = S.X = N;
+  for (int I = 0; I < S.X; ++I)
+    Res += S.Y;
+  return Res;
+}
+
+double bar() {
+  double S = 0;
+  for (int I = 0; I < 10; ++I)
+    S += I;
+  return S;
+}
+//CHECK: Printing analysis 'Dependency Analysis (Metadata)' for function 'foo':
+//CHECK:  loop at depth 1 incremental_1.c:7:3
+//CHECK:    induction:
+//CHECK:     <I:7[7:3], 4>:[Int,0,,1] | <Res:5, 8>:[Fp,,,]
+//CHECK:    read only:
+//CHECK:     <S:4, 24>
+//CHECK:    lock:
+//CHECK:     <I:7[7:3], 4> | <S:4, 24>
+//CHECK:    header access:
+//CHECK:     <I:7[7:3], 4> | <S:4, 24>
+//CHECK:    explicit access:
+//CHECK:     <I:7[7:3], 4> | <Res:5, 8>
+//CHECK:    explicit access (separate):
+//CHECK:     <I:7[7:3], 4> <Res:5, 8>
+//CHECK:    lock (separate):
+//CHECK:     <I:7[7:3], 4> <S:4, 24>
+//CHECK:    direct access (separate):
+//CHECK:     <I:7[7:3], 4> <Res:5, 8> <S:4, 24>
+//CHECK: Printing analysis 'Dependency Analysis (Metadata)' for function 'bar':
+//CHECK:  loop at depth 1 incremental_1.c:14:3
+//CHECK:    induction:
+//CHECK:     <I:14[14:3], 4>:[Int,0,10,1]
+//CHECK:    reduction:
+//CHECK:     <S:13, 8>:add
+//CHECK:    lock:
+//CHECK:     <I:14[14:3], 4>
+//CHECK:    header access:
+//CHECK:     <I:14[14:3], 4>
+//CHECK:    explicit access:
+//CHECK:     <I:14[14:3], 4> | <S:13, 8>
+//CHECK:    explicit access (separate):
+//CHECK:     <I:14[14:3], 4> <S:13, 8>
+//CHECK:    lock (separate):
+//CHECK:     <I:14[14:3], 4>
+//CHECK:    direct access (separate):
+//CHECK:     <I:14[14:3], 4> <S:13, 8>
+//CHECK-1: Printing analysis 'Dependency Analysis (Metadata)' for function 'foo':
+//CHECK-1:  loop at depth 1 incremental_1.c:7:3
+//CHECK-1:    induction:
+//CHECK-1:     <I:7[7:3], 4>:[Int,0,,1] | <Res:5, 8>:[Fp,,,]
+//CHECK-1:    read only:
+//CHECK-1:     <S:4, 32>
+//CHECK-1:    lock:
+//CHECK-1:     <I:7[7:3], 4> | <S:4, 32>
+//CHECK-1:    header access:
+//CHECK-1:     <I:7[7:3], 4> | <S:4, 32>
+//CHECK-1:    explicit access:
+//CHECK-1:     <I:7[7:3], 4> | <Res:5, 8>
+//CHECK-1:    explicit access (separate):
+//CHECK-1:     <I:7[7:3], 4> <Res:5, 8>
+//CHECK-1:    lock (separate):
+//CHECK-1:     <I:7[7:3], 4> <S:4, 32>
+//CHECK-1:    direct access (separate):
+//CHECK-1:     <I:7[7:3], 4> <Res:5, 8> <S:4, 32>
+//CHECK-1: Reusing cached results for function 'bar':
+//CHECK-1: Printing analysis 'Dependency Analysis (Metadata)' for function 'bar':
+//CHECK-1:  loop at depth 1 incremental_1.c:14:3
+//CHECK-1:    induction:
+//CHECK-1:     <I:14[14:3], 4>:[Int,0,10,1]
+//CHECK-1:    reduction:
+//CHECK-1:     <S:13, 8>:add
+//CHECK-1:    lock:
+//CHECK-1:     <I:14[14:3], 4>
+//CHECK-1:    header access:
+//CHECK-1:     <I:14[14:3], 4>
+//CHECK-1:    explicit access:
+//CHECK-1:     <I:14[14:3], 4> | <S:13, 8>
+//CHECK-1:    explicit access (separate):
+//CHECK-1:     <I:14[14:3], 4> <S:13, 8>
+//CHECK-1:    lock (separate):
+//CHECK-1:     <I:14[14:3], 4>
+//CHECK-1:    direct access (separate):
+//CHECK-1:     <I:14[14:3], 4> <S:13, 8>
@@ -0,0 +1 @@
+int Start, End;
@@ -0,0 +1,6 @@
+#include <jobs_1.h>
+
+void bar(int * restrict A) {
+  for (int I = End - 1; I >= Start; --I)
+    A[I] = I;
+}
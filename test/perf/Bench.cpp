@@ -0,0 +1,370 @@
+//===--- Bench.cpp ----------- TSAR Throughput Benchmark --------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This benchmark measures end-to-end throughput of TSAR. It runs the tsar
+// executable over a corpus of source files with the following pipelines:
+// - analysis: default analysis pipeline (DefaultQueryManager), the pipeline
+//   is run for each processing step, so wall time of each stage is estimated
+//   as a difference between runs which stop after the current and after the
+//   previous step;
+// - server: analysis on the analysis server with a subsequent transformation;
+// - instrumentation: instrumentation of LLVM IR.
+//
+// Results (wall time, peak RSS, functions/sec and loops/sec) are emitted in
+// JSON format. They may be stored and used as a baseline for the following
+// runs, the benchmark fails if some of results are worse than the baseline.
+// The benchmark also fails if some of runs fail, results of such runs are
+// excluded from the accumulated results.
+//
+//===----------------------------------------------------------------------===//
+
+#include <tsar/Core/tsar-config.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::OptionCategory BenchCategory("Benchmark options");
+
+static cl::list<std::string> Sources(cl::Positional, cl::OneOrMore,
+  cl::desc("<source files>"), cl::cat(BenchCategory));
+
+static cl::opt<std::string> TsarPath("tsar", cl::value_desc("path"),
+  cl::desc("Path to the tsar executable (default: next to this benchmark)"),
+  cl::cat(BenchCategory));
+
+static cl::opt<std::string> Output("o", cl::value_desc("filename"),
+  cl::desc("Write results to a file (default: stdout)"),
+  cl::cat(BenchCategory));
+
+static cl::opt<std::string> Baseline("baseline", cl::value_desc("filename"),
+  cl::desc("Compare results with a previously stored baseline"),
+  cl::cat(BenchCategory));
+
+static cl::opt<double> Threshold("threshold", cl::init(10.0),
+  cl::desc("Allowed slowdown in percent before a result is a regression"),
+  cl::cat(BenchCategory));
+
+static cl::opt<double> MinDelta("min-delta", cl::init(0.05),
+  cl::desc("Slowdown in seconds which is always treated as noise"),
+  cl::cat(BenchCategory));
+
+static cl::opt<unsigned> Repeat("repeat", cl::init(3),
+  cl::desc("Number of runs for each measurement (the best run is used)"),
+  cl::cat(BenchCategory));
+
+namespace {
+/// Number of processing steps in the default analysis pipeline.
+constexpr unsigned NumberOfSteps = 3;
+
+/// Results of a single measurement.
+struct Measurement {
+  double Wall = 0;
+  uint64_t PeakRSS = 0;
+  unsigned Functions = 0;
+  unsigned Loops = 0;
+  unsigned Failures = 0;
+
+  /// Accumulates results of a measurement. Results of a failed measurement
+  /// are incomplete, so only the number of failures is accumulated.
+  Measurement & operator+=(const Measurement &RHS) {
+    Failures += RHS.Failures;
+    if (RHS.Failures > 0)
+      return *this;
+    Wall += RHS.Wall;
+    PeakRSS = std::max(PeakRSS, RHS.PeakRSS);
+    Functions += RHS.Functions;
+    Loops += RHS.Loops;
+    return *this;
+  }
+};
+
+/// Counts analyzed functions and loops in results printed by the
+/// default analysis pipeline.
+void countFunctionsAndLoops(StringRef Log, Measurement &M) {
+  SmallVector<StringRef, 64> Lines;
+  Log.split(Lines, '\n');
+  for (auto Line : Lines) {
+    Line = Line.ltrim();
+    if (Line.startswith("Printing analysis '") &&
+        Line.contains("' for function '"))
+      ++M.Functions;
+    else if (Line.startswith("loop at depth "))
+      ++M.Loops;
+  }
+}
+
+/// Runs tsar with specified arguments in a temporary directory which
+/// contains a copy of a specified source file.
+///
+/// The directory of the source file is added to the include search path,
+/// so local headers of the source are available. The best of `Repeat` runs
+/// is returned. If some of runs fail, the number of failures is set only.
+Measurement run(StringRef Source, ArrayRef<std::string> Options) {
+  Measurement Best;
+  Best.Wall = -1;
+  SmallString<128> WorkDir;
+  if (sys::fs::createUniqueDirectory("tsar-bench", WorkDir)) {
+    errs() << "error: unable to create temporary directory\n";
+    ++Best.Failures;
+    return Best;
+  }
+  SmallString<128> Sample(WorkDir);
+  sys::path::append(Sample, sys::path::filename(Source));
+  SmallString<128> Log(WorkDir);
+  sys::path::append(Log, "tsar-bench.log");
+  if (sys::fs::copy_file(Source, Sample)) {
+    errs() << "error: unable to copy '" << Source << "'\n";
+    sys::fs::remove_directories(WorkDir);
+    ++Best.Failures;
+    return Best;
+  }
+  SmallString<128> SourceDir(Source);
+  sys::fs::make_absolute(SourceDir);
+  sys::path::remove_filename(SourceDir);
+  std::vector<StringRef> Args{TsarPath, Sample, "-I", SourceDir};
+  for (auto &Opt : Options)
+    Args.push_back(Opt);
+  Optional<StringRef> Redirects[] = {None, StringRef(Log), StringRef(Log)};
+  for (unsigned I = 0; I < Repeat; ++I) {
+    Optional<sys::ProcessStatistics> Stat;
+    std::string ErrMsg;
+    auto Start = std::chrono::steady_clock::now();
+    int RC = sys::ExecuteAndWait(TsarPath, Args, None, Redirects, 0, 0,
+                                 &ErrMsg, nullptr, &Stat);
+    std::chrono::duration<double> Wall =
+        std::chrono::steady_clock::now() - Start;
+    if (RC != 0) {
+      errs() << "error: tsar failed on '" << Source << "'";
+      if (!ErrMsg.empty())
+        errs() << ": " << ErrMsg;
+      errs() << "\n";
+      Best = Measurement();
+      ++Best.Failures;
+      break;
+    }
+    if (Best.Wall >= 0 && Best.Wall <= Wall.count())
+      continue;
+    Best = Measurement();
+    Best.Wall = Wall.count();
+    if (Stat)
+      Best.PeakRSS = Stat->PeakMemory;
+    if (auto Buffer = MemoryBuffer::getFile(Log))
+      countFunctionsAndLoops((*Buffer)->getBuffer(), Best);
+  }
+  sys::fs::remove_directories(WorkDir);
+  return Best;
+}
+
+json::Object toJSON(const Measurement &M) {
+  json::Object Obj{
+      {"wall", M.Wall},
+      {"peak_rss_kb", static_cast<int64_t>(M.PeakRSS)},
+      {"failures", M.Failures}};
+  if (M.Functions > 0) {
+    Obj["functions"] = M.Functions;
+    Obj["functions_per_sec"] = M.Wall > 0 ? M.Functions / M.Wall : 0;
+  }
+  if (M.Loops > 0) {
+    Obj["loops"] = M.Loops;
+    Obj["loops_per_sec"] = M.Wall > 0 ? M.Loops / M.Wall : 0;
+  }
+  return Obj;
+}
+
+/// Compares results with a baseline, returns `false` if there are
+/// regressions or failed runs.
+bool compare(const json::Object &Results, const json::Object &Baseline) {
+  bool IsOk = true;
+  auto check = [&IsOk](StringRef Pipeline, StringRef Key,
+                       const json::Object &Curr, const json::Object &Base) {
+    auto CurrV = Curr.getNumber(Key), BaseV = Base.getNumber(Key);
+    if (!CurrV || !BaseV || *BaseV <= 0)
+      return;
+    auto Diff = (*CurrV - *BaseV) / *BaseV * 100;
+    errs().indent(2) << Pipeline << "." << Key << ": "
+                     << format("%.3f", *BaseV) << " -> "
+                     << format("%.3f", *CurrV) << " ("
+                     << (Diff > 0 ? "+" : "") << format("%.1f", Diff) << "%)";
+    if (Diff > Threshold &&
+        (Key != "wall" || *CurrV - *BaseV > MinDelta)) {
+      errs() << " REGRESSION";
+      IsOk = false;
+    }
+    errs() << "\n";
+  };
+  auto *Pipelines = Results.getObject("pipelines");
+  auto *BasePipelines = Baseline.getObject("pipelines");
+  if (!Pipelines || !BasePipelines)
+    return IsOk;
+  errs() << "Comparison with the baseline:\n";
+  for (auto &P : *Pipelines) {
+    auto *Curr = P.second.getAsObject();
+    auto *Base = BasePipelines->getObject(P.first);
+    if (!Curr)
+      continue;
+    if (auto Failures = Curr->getInteger("failures"))
+      if (*Failures > 0) {
+        errs().indent(2) << P.first << ".failures: " << *Failures
+                         << " FAILURE\n";
+        IsOk = false;
+      }
+    if (!Base)
+      continue;
+    for (auto *Key : {"wall", "peak_rss_kb"})
+      check(P.first, Key, *Curr, *Base);
+    auto *Stages = Curr->getObject("stages");
+    auto *BaseStages = Base->getObject("stages");
+    if (Stages && BaseStages)
+      for (auto &S : *Stages)
+        if (auto *BaseStage = BaseStages->getObject(S.first))
+          if (auto *Stage = S.second.getAsObject())
+            check((Twine(StringRef(P.first)) + ".stage" +
+                   StringRef(S.first)).str(),
+                  "wall", *Stage, *BaseStage);
+  }
+  return IsOk;
+}
+}
+
+int main(int Argc, char **Argv) {
+  InitLLVM X(Argc, Argv);
+  cl::HideUnrelatedOptions(BenchCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+    "TSAR end-to-end throughput benchmark\n");
+  if (TsarPath.empty()) {
+    SmallString<128> Path(sys::fs::getMainExecutable(
+      Argv[0], reinterpret_cast<void *>(&main)));
+    sys::path::remove_filename(Path);
+    sys::path::append(Path, "tsar");
+    TsarPath = std::string(Path);
+  }
+  if (Repeat == 0)
+    Repeat = 1;
+  json::Object Pipelines;
+  unsigned NumFailures = 0;
+  // Default analysis pipeline. Stages after the requested one are not
+  // scheduled, so the wall time of a stage is a difference between runs.
+  {
+    Measurement Total;
+    json::Object Stages;
+    std::vector<Measurement> StepResults(NumberOfSteps);
+    for (auto &Source : Sources) {
+      // Wall time of a stage is a difference between steps, so results for
+      // a source are accumulated only if all steps succeed.
+      std::vector<Measurement> SourceResults;
+      bool IsFailed = false;
+      for (unsigned Step = 1; Step <= NumberOfSteps && !IsFailed; ++Step) {
+        SourceResults.push_back(run(Source,
+          {"-print-only=da-di", "-print-step=" + std::to_string(Step),
+           "-fno-analyze-library-functions"}));
+        IsFailed = SourceResults.back().Failures > 0;
+      }
+      if (IsFailed)
+        Total.Failures += SourceResults.back().Failures;
+      else
+        for (unsigned Step = 1; Step <= NumberOfSteps; ++Step)
+          StepResults[Step - 1] += SourceResults[Step - 1];
+    }
+    for (unsigned Step = 1; Step <= NumberOfSteps; ++Step) {
+      Measurement Stage = StepResults[Step - 1];
+      if (Step > 1)
+        Stage.Wall = std::max(0.0, Stage.Wall - StepResults[Step - 2].Wall);
+      Stages[std::to_string(Step)] = json::Object{{"wall", Stage.Wall}};
+    }
+    Total += StepResults[NumberOfSteps - 1];
+    // The number of analyzed functions and loops is the same for all steps,
+    // but the results of the first step are the most reliable because
+    // transformations may remove some loops.
+    Total.Functions = StepResults.front().Functions;
+    Total.Loops = StepResults.front().Loops;
+    NumFailures += Total.Failures;
+    auto Obj = toJSON(Total);
+    Obj["stages"] = std::move(Stages);
+    Pipelines["analysis"] = std::move(Obj);
+  }
+  // Analysis on the server with a subsequent transformation.
+  {
+    Measurement Total;
+    for (auto &Source : Sources)
+      Total += run(Source, {"-clang-openmp-parallel", "-use-analysis-server",
+                            "-output-suffix=bench"});
+    NumFailures += Total.Failures;
+    Pipelines["server"] = toJSON(Total);
+  }
+  // Instrumentation of LLVM IR.
+  {
+    Measurement Total;
+    for (auto &Source : Sources)
+      Total += run(Source, {"-instr-llvm"});
+    NumFailures += Total.Failures;
+    Pipelines["instrumentation"] = toJSON(Total);
+  }
+  json::Object Results{
+    {"tsar_version", TSAR_VERSION_STRING},
+    {"llvm_version", LLVM_VERSION_STRING},
+    {"files", static_cast<int64_t>(Sources.size())},
+    {"pipelines", std::move(Pipelines)}};
+  std::error_code EC;
+  std::string OutputFile = Output.empty() ? "-" : Output.getValue();
+  raw_fd_ostream OS(OutputFile, EC, sys::fs::OF_Text);
+  if (EC) {
+    errs() << "error: " << EC.message() << "\n";
+    return 1;
+  }
+  OS << formatv("{0:2}", json::Value(json::Object(Results))) << "\n";
+  OS.flush();
+  if (NumFailures > 0)
+    errs() << "error: " << NumFailures << " run(s) of tsar failed\n";
+  if (Baseline.empty())
+    return NumFailures > 0 ? 1 : 0;
+  auto Buffer = MemoryBuffer::getFile(Baseline);
+  if (!Buffer) {
+    errs() << "error: unable to read baseline '" << Baseline << "'\n";
+    return 1;
+  }
+  auto BaseV = json::parse((*Buffer)->getBuffer());
+  if (!BaseV) {
+    errs() << "error: unable to parse baseline '" << Baseline
+           << "': " << toString(BaseV.takeError()) << "\n";
+    return 1;
+  }
+  auto *BaseObj = BaseV->getAsObject();
+  if (!BaseObj) {
+    errs() << "error: unable to parse baseline '" << Baseline << "'\n";
+    return 1;
+  }
+  return compare(Results, *BaseObj) && NumFailures == 0 ? 0 : 1;
+}
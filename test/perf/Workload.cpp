@@ -0,0 +1,235 @@
+//===- Workload.cpp ------- Synthetic Workload Generator --------*- C++ -*-===//
+//
+//                       Traits Static Analyzer (SAPFOR)
+//
+// Copyright 2020 DVM System Group
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//===----------------------------------------------------------------------===//
+//
+// This tool generates parameterized C programs to evaluate how TSAR scales
+// with the size of a program. The following parameters can be specified:
+// - number of functions,
+// - number of loop nests per function and depth of each nest,
+// - number of arrays accessed in each loop nest,
+// - density of pointer aliasing (probability that different pointer
+//   parameters of a function refer to the same array at a call site),
+// - depth of a call graph.
+// A generated program is deterministic for a specified seed, so it can be
+// used as a part of a benchmark corpus (see tsar-bench).
+//
+//===----------------------------------------------------------------------===//
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/InitLLVM.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <random>
+#include <string>
+
+using namespace llvm;
+
+static cl::OptionCategory WorkloadCategory("Workload options");
+
+static cl::opt<unsigned> NumFunctions("functions", cl::init(16),
+  cl::desc("Number of functions (excluding main)"), cl::cat(WorkloadCategory));
+
+static cl::opt<unsigned> NumLoops("loops", cl::init(4),
+  cl::desc("Number of loop nests per function"), cl::cat(WorkloadCategory));
+
+static cl::opt<unsigned> NestDepth("nest-depth", cl::init(2),
+  cl::desc("Depth of each loop nest"), cl::cat(WorkloadCategory));
+
+static cl::opt<unsigned> NumArrays("arrays", cl::init(4),
+  cl::desc("Number of arrays accessed in each function"),
+  cl::cat(WorkloadCategory));
+
+static cl::opt<unsigned> Aliasing("aliasing", cl::init(25),
+  cl::desc("Probability (in percent) that a pointer argument refers to the "
+           "same array as some other argument"),
+  cl::cat(WorkloadCategory));
+
+static cl::opt<unsigned> CallDepth("call-depth", cl::init(4),
+  cl::desc("Depth of a call graph"), cl::cat(WorkloadCategory));
+
+static cl::opt<unsigned> ArraySize("size", cl::init(64),
+  cl::desc("Extent of each dimension of arrays"), cl::cat(WorkloadCategory));
+
+static cl::opt<unsigned> Seed("seed", cl::init(0),
+  cl::desc("Seed of a random number generator"), cl::cat(WorkloadCategory));
+
+static cl::opt<std::string> Output("o", cl::value_desc("filename"),
+  cl::desc("Write a generated program to a file (default: stdout)"),
+  cl::cat(WorkloadCategory));
+
+namespace {
+class WorkloadGenerator {
+public:
+  WorkloadGenerator(raw_ostream &OS) : mOS(OS), mRand(Seed) {}
+
+  void generate() {
+    writeHeader();
+    for (unsigned I = 0; I < NumArrays; ++I)
+      mOS << "double A" << I << dims(NestDepth) << ";\n";
+    mOS << "\n";
+    // Functions are distributed over levels of a call graph. A function
+    // calls some of functions from the next level, so it is necessary to
+    // generate functions in reverse order.
+    for (unsigned F = NumFunctions; F > 0; --F)
+      writeFunction(F - 1);
+    writeMain();
+  }
+
+private:
+  std::string dims(unsigned Depth) const {
+    std::string Str;
+    for (unsigned I = 0; I < Depth; ++I)
+      Str += "[" + std::to_string(ArraySize) + "]";
+    return Str;
+  }
+
+  unsigned level(unsigned F) const { return F % std::max(1u, CallDepth.getValue()); }
+
+  bool chance(unsigned Percent) {
+    return std::uniform_int_distribution<unsigned>(0, 99)(mRand) < Percent;
+  }
+
+  unsigned random(unsigned Max) {
+    return Max == 0 ? 0 :
+      std::uniform_int_distribution<unsigned>(0, Max - 1)(mRand);
+  }
+
+  void writeHeader() {
+    mOS << "// Generated by tsar-workload:";
+    mOS << " -functions=" << NumFunctions << " -loops=" << NumLoops
+        << " -nest-depth=" << NestDepth << " -arrays=" << NumArrays
+        << " -aliasing=" << Aliasing << " -call-depth=" << CallDepth
+        << " -size=" << ArraySize << " -seed=" << Seed << "\n\n";
+    mOS << "#include <stdio.h>\n\n";
+  }
+
+  /// Write a list of arguments to call a function, some arguments may
+  /// refer to the same array.
+  void writeArgs(ArrayRef<std::string> Arrays) {
+    SmallVector<unsigned, 8> Args;
+    for (unsigned I = 0; I < NumArrays; ++I) {
+      if (I > 0 && chance(Aliasing))
+        Args.push_back(Args[random(I)]);
+      else
+        Args.push_back(I);
+    }
+    for (unsigned I = 0; I < NumArrays; ++I)
+      mOS << (I > 0 ? ", " : "") << Arrays[Args[I]];
+  }
+
+  void writeLoopNest(unsigned L) {
+    std::string Indent = "  ";
+    std::string Subscript, Prev;
+    for (unsigned D = 0; D < NestDepth; ++D) {
+      mOS << Indent << "for (int I" << D << " = 1; I" << D << " < "
+          << ArraySize - 1 << "; ++I" << D << ")";
+      mOS << (D + 1 == NestDepth ? " {\n" : "\n");
+      Indent += "  ";
+      Subscript += "[I" + std::to_string(D) + "]";
+      Prev += "[I" + std::to_string(D) + (D + 1 == NestDepth ? " - 1]" : "]");
+    }
+    auto Dst = random(NumArrays), Src = random(NumArrays);
+    auto Other = random(NumArrays);
+    // Mix private scalars, reductions and accesses to arrays which may be
+    // aliases to produce different traits.
+    mOS << Indent << "double T = P" << Src << Prev << " * " << (L + 1)
+        << ".0;\n";
+    mOS << Indent << "P" << Dst << Subscript << " = T + P" << Other
+        << Subscript << ";\n";
+    mOS << Indent << "S += T;\n";
+    mOS << "  " << std::string(2 * (NestDepth - 1), ' ') << "}\n";
+  }
+
+  void writeFunction(unsigned F) {
+    mOS << "double f" << F << "(";
+    for (unsigned I = 0; I < NumArrays; ++I)
+      mOS << (I > 0 ? ", " : "") << "double (*P" << I << ")"
+          << dims(NestDepth).substr(dims(1).size());
+    mOS << ") {\n";
+    mOS << "  double S = 0;\n";
+    for (unsigned L = 0; L < NumLoops; ++L)
+      writeLoopNest(L);
+    // Call some functions from the next level of a call graph.
+    auto Level = level(F);
+    if (Level + 1 < CallDepth) {
+      SmallVector<std::string, 8> Params;
+      for (unsigned I = 0; I < NumArrays; ++I)
+        Params.push_back("P" + std::to_string(I));
+      for (unsigned Callee = F + 1; Callee < NumFunctions; ++Callee) {
+        if (level(Callee) != Level + 1)
+          continue;
+        mOS << "  S += f" << Callee << "(";
+        writeArgs(Params);
+        mOS << ");\n";
+        break;
+      }
+    }
+    mOS << "  return S;\n";
+    mOS << "}\n\n";
+  }
+
+  void writeMain() {
+    SmallVector<std::string, 8> Arrays;
+    for (unsigned I = 0; I < NumArrays; ++I)
+      Arrays.push_back("A" + std::to_string(I));
+    mOS << "int main() {\n";
+    mOS << "  double S = 0;\n";
+    for (unsigned F = 0; F < NumFunctions; ++F) {
+      if (level(F) != 0)
+        continue;
+      mOS << "  S += f" << F << "(";
+      writeArgs(Arrays);
+      mOS << ");\n";
+    }
+    mOS << "  printf(\"%e\\n\", S);\n";
+    mOS << "  return 0;\n";
+    mOS << "}\n";
+  }
+
+  raw_ostream &mOS;
+  std::mt19937 mRand;
+};
+}
+
+int main(int Argc, char **Argv) {
+  InitLLVM X(Argc, Argv);
+  cl::HideUnrelatedOptions(WorkloadCategory);
+  cl::ParseCommandLineOptions(Argc, Argv,
+    "Generator of synthetic workloads for TSAR\n");
+  if (NestDepth == 0) {
+    errs() << "error: depth of a loop nest must be positive\n";
+    return 1;
+  }
+  if (NumArrays == 0) {
+    errs() << "error: number of arrays must be positive\n";
+    return 1;
+  }
+  std::error_code EC;
+  std::string OutputFile = Output.empty() ? "-" : Output.getValue();
+  raw_fd_ostream OS(OutputFile, EC, sys::fs::OF_Text);
+  if (EC) {
+    errs() << "error: " << EC.message() << "\n";
+    return 1;
+  }
+  WorkloadGenerator(OS).generate();
+  return 0;
+}
@@ -50,6 +50,7 @@
 #include "tsar/Core/Query.h"
 #include "tsar/Core/TransformationContext.h"
 #include "tsar/Support/Clang/Utils.h"
+#include "tsar/Support/FunctionResultCache.h"
 #include "tsar/Support/GlobalOptions.h"
 #include "tsar/Support/NumericUtils.h"
 #include "tsar/Support/PassAAProvider.h"
@@ -908,6 +909,11 @@ private:
   AnalysisSocket *mSocket = nullptr;
   GlobalsAAResult * mGlobalsAA = nullptr;
 
+  /// Answers which have been already sent to a client. The module is not
+  /// changed while the server is running, so the same requests obtain
+  /// the same answers and analysis should not be performed again.
+  FunctionResultCache<std::string> mAnswerCache;
+
   /// List of canonical function declarations which is visible to user in GUI.
   /// GUI knowns this function and it can highlight some information if
   /// necessary.
@@ -1007,6 +1013,8 @@ INITIALIZE_PASS_END(PrivateServerPass, "server-private",
   "Server Private Pass", true, true)
 
 std::string PrivateServerPass::answerStatistic(llvm::Module &M) {
+  if (auto *Answer = mAnswerCache.lookup(nullptr, 0))
+    return *Answer;
   msg::Statistic Stat;
   auto &Rewriter = mTfmCtx->getRewriter();
   for (auto FI = Rewriter.getSourceMgr().fileinfo_begin(),
@@ -1060,7 +1068,8 @@ std::string PrivateServerPass::answerStatistic(llvm::Module &M) {
     std::make_pair(msg::Analysis::Yes, Loops.first));
   Stat[msg::Statistic::Loops].insert(
     std::make_pair(msg::Analysis::No, Loops.second));
-  return json::Parser<msg::Statistic>::unparseAsObject(Stat);
+  return mAnswerCache.insert(nullptr, 0,
+    json::Parser<msg::Statistic>::unparseAsObject(Stat));
 }
 
 std::string PrivateServerPass::answerLoopTree(llvm::Module &M,
@@ -1076,6 +1085,8 @@ std::string PrivateServerPass::answerLoopTree(llvm::Module &M,
       continue;
     if (F.isDeclaration())
       return json::Parser<msg::LoopTree>::unparseAsObject(Request);
+    if (auto *Answer = mAnswerCache.lookup(&F, 0))
+      return *Answer;
     msg::LoopTree LoopTree;
     LoopTree[msg::LoopTree::FunctionID] = Request[msg::LoopTree::FunctionID];
     auto &SrcMgr = mTfmCtx->getContext().getSourceManager();
@@ -1172,7 +1183,8 @@ std::string PrivateServerPass::answerLoopTree(llvm::Module &M,
       Loop[msg::Loop::Level] = Levels.size() + 1;
       Levels.push_back(Loop[msg::Loop::EndLocation]);
     }
-    return json::Parser<msg::LoopTree>::unparseAsObject(LoopTree);
+    return mAnswerCache.insert(&F, 0,
+      json::Parser<msg::LoopTree>::unparseAsObject(LoopTree));
   }
   return json::Parser<msg::LoopTree>::unparseAsObject(Request);
 }
@@ -1397,6 +1409,9 @@ std::string PrivateServerPass::answerAliasTree(llvm::Module &M,
       continue;
     if (F.isDeclaration())
       return json::Parser<msg::AliasTree>::unparseAsObject(Request);
+    if (auto *Answer =
+          mAnswerCache.lookup(&F, Request[msg::AliasTree::LoopID]))
+      return *Answer;
     auto &SrcMgr = mTfmCtx->getContext().getSourceManager();
     auto &Provider = getAnalysis<ServerPrivateProvider>(F);
     auto &LoopMatcher = Provider.get<LoopMatcherPass>().getMatcher();
@@ -1540,7 +1555,8 @@ std::string PrivateServerPass::answerAliasTree(llvm::Module &M,
             reinterpret_cast<std::uintptr_t>(&C), N[msg::AliasNode::Kind]);
         }
       }
-      return json::Parser<msg::AliasTree>::unparseAsObject(Response);
+      return mAnswerCache.insert(&F, Request[msg::AliasTree::LoopID],
+        json::Parser<msg::AliasTree>::unparseAsObject(Response));
     }
   }
   return json::Parser<msg::AliasTree>::unparseAsObject(Request);
@@ -1557,6 +1573,7 @@ bool PrivateServerPass::runOnModule(llvm::Module &M) {
   assert(mSocket && "Active socket must be specified!");
   mGlobalsAA = &getAnalysis<GlobalsAAWrapperPass>().getResult();
   mGlobalOpts = &getAnalysis<GlobalOptionsImmutableWrapper>().getOptions();
+  mAnswerCache.setMemoryLimit(mGlobalOpts->AnswerCacheLimit * 1024 * 1024);
   if (!mTfmCtx || !mTfmCtx->hasInstance()) {
     M.getContext().emitError("can not access sources"
         ": transformation context is not available");
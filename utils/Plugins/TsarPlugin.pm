@@ -48,6 +48,9 @@
 #
 #  Note, it is possible to use a comand like '| -check-prefix=...' to discard
 #  a specified prefix which became unsed.
+#
+#  Note, '%t' in a command is replaced with a temporary directory which is
+#  shared between all commands of a test and is removed if the test succeeds.
 #===------------------------------------------------------------------------===#
 
 package Plugins::TsarPlugin;
@@ -205,6 +208,7 @@ sub process {
     my $check_prefix = 'CHECK';
     my ($exec, $check_args) = $_ =~ m/^\s*(.*?)\s*(?:\|\s*(.*)\s*)?$/;
     !$check_args or (($check_prefix) = $check_args =~ m/^-check-prefix=(.*)$/);
+    $exec =~ s/%t/$work_dir/g;
     dbg1 and dprint("check prefix is set to '$check_prefix'");
     if (!$exec) {
       dbg1 and dprint("ignore empty command");